@@ -0,0 +1,84 @@
+/*
+ * Dict insert and lookup cost in ns per operation. For each size, builds
+ * tables of route-like keys, then looks every key up (hits) and as many
+ * absent keys (misses), repeating each phase until it has done at least
+ * MIN_OPS operations and keeping the best of ROUNDS runs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "gc.h"
+#include "dict.h"
+
+#define ROUNDS 5
+#define MIN_OPS 1000000
+
+static double elapsed_ns(clock_t start, size_t ops) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / ops;
+}
+
+static void report(size_t count) {
+    char **keys = malloc(sizeof(char*) * count);
+    char **absent = malloc(sizeof(char*) * count);
+    char buffer[64];
+    for (size_t i = 0; i < count; i++) {
+        snprintf(buffer, sizeof(buffer), "/api/v1/route/%zu", i);
+        keys[i] = gc_strdup(buffer);
+        snprintf(buffer, sizeof(buffer), "/api/v2/missing/%zu", i);
+        absent[i] = gc_strdup(buffer);
+    }
+
+    size_t repeat = count >= MIN_OPS ? 1 : MIN_OPS / count;
+    size_t ops = count * repeat;
+    double insert = 0, hit = 0, miss = 0;
+    size_t found = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        Dict dict;
+        clock_t start = clock();
+        for (size_t r = 0; r < repeat; r++) {
+            if (r > 0) dict_release(&dict);
+            dict_init(&dict, 0);
+            for (size_t i = 0; i < count; i++) {
+                dict_set(&dict, keys[i], value_number((double)i));
+            }
+        }
+        double t_insert = elapsed_ns(start, ops);
+
+        found = 0;
+        start = clock();
+        for (size_t r = 0; r < repeat; r++) {
+            for (size_t i = 0; i < count; i++) {
+                found += dict_find(&dict, keys[i]) != NULL;
+            }
+        }
+        double t_hit = elapsed_ns(start, ops);
+
+        start = clock();
+        for (size_t r = 0; r < repeat; r++) {
+            for (size_t i = 0; i < count; i++) {
+                found += dict_find(&dict, absent[i]) != NULL;
+            }
+        }
+        double t_miss = elapsed_ns(start, ops);
+
+        dict_release(&dict);
+
+        if (round == 0 || t_insert < insert) insert = t_insert;
+        if (round == 0 || t_hit < hit) hit = t_hit;
+        if (round == 0 || t_miss < miss) miss = t_miss;
+    }
+
+    printf("%8zu keys  insert %7.1f ns  hit %7.1f ns  miss %7.1f ns  (%zu found)\n",
+           count, insert, hit, miss, found / repeat);
+    free(keys);
+    free(absent);
+}
+
+int main(void) {
+    report(16);
+    report(1000);
+    report(10000);
+    report(100000);
+    gc_release_all();
+    return 0;
+}
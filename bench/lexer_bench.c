@@ -0,0 +1,89 @@
+/*
+ * Lexer throughput in MB/s over generated .tess sources. Each corpus is
+ * built in memory by repeating a template until it reaches CORPUS_SIZE,
+ * then tokenized repeatedly for at least MIN_SECONDS.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
+
+#define CORPUS_SIZE (8 * 1024 * 1024)
+#define MIN_SECONDS 1.0
+
+static const char *code_template =
+    "cls Handler%d {\n"
+    "    f! handle(request, count) {\n"
+    "        status = 200\n"
+    "        total = count * 3 + %d %% 7\n"
+    "        if total >= 10 { total = total - 1 } else { total = total + 1 }\n"
+    "        while count > 0 {\n"
+    "            count = count - 1\n"
+    "            if count == 5 { break }\n"
+    "        }\n"
+    "        repeat 3 { print:: \"tick\", total }\n"
+    "        try { result = request.get_header(\"Accept\") } catch { ret null }\n"
+    "        response = new Response()\n"
+    "        ret response.send(status, total)\n"
+    "    }\n"
+    "}\n";
+
+static const char *comment_template =
+    "# Handler %d: validates the incoming payload, looks up the account and\n"
+    "# returns a JSON body. Errors are reported with a 4xx status and a short\n"
+    "# message; anything unexpected becomes a 500 with the request id logged.\n"
+    "$$ Route registered at startup, see routes table entry %d for details.\n"
+    "f! route_%d(request) {\n"
+    "    ret request  # pass-through until the real handler lands\n"
+    "}\n";
+
+static const char *string_template =
+    "body_%d = \"{\\\"id\\\": %d, \\\"name\\\": \\\"example account\\\", \\\"tags\\\": [\\\"a\\\", \\\"b\\\"]}\"\n"
+    "header_%d = \"Content-Type: application/json; charset=utf-8\"\n"
+    "message_%d = \"The quick brown fox jumps over the lazy dog while the server keeps running.\"\n";
+
+static char* build_corpus(const char *template, size_t *length) {
+    char *source = malloc(CORPUS_SIZE + 4096);
+    size_t used = 0;
+    int i = 0;
+    while (used < CORPUS_SIZE) {
+        used += (size_t)snprintf(source + used, 4096, template, i, i, i, i);
+        i++;
+    }
+    *length = used;
+    return source;
+}
+
+static void run_corpus(const char *name, const char *template) {
+    size_t length;
+    char *source = build_corpus(template, &length);
+    size_t token_count = 0;
+    int iterations = 0;
+
+    clock_t start = clock();
+    double elapsed = 0;
+    while (elapsed < MIN_SECONDS) {
+        Arena *arena = arena_create();
+        Lexer *lexer = lexer_create(source, length, arena);
+        lexer_tokenize(lexer);
+        token_count = lexer->token_count;
+        lexer_destroy(lexer);
+        arena_destroy(arena);
+        iterations++;
+        elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+    }
+
+    double megabytes = (double)length * iterations / (1024.0 * 1024.0);
+    printf("%-9s %6.1f MB/s  %7.1f Mtokens/s  (%zu bytes, %zu tokens)\n",
+           name, megabytes / elapsed, (double)token_count * iterations / elapsed / 1e6,
+           length, token_count);
+    free(source);
+}
+
+int main(void) {
+    run_corpus("code", code_template);
+    run_corpus("comments", comment_template);
+    run_corpus("strings", string_template);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Module startup cost with and without .tessc caches. Writes MODULE_COUNT
+ * generated modules into the directory given on the command line, then
+ * times parsing all of them with the cache off, cold (caches deleted, so
+ * each parse also writes one) and warm (every module served from cache).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "module_cache.h"
+
+#define MODULE_COUNT 200
+#define FUNCTIONS_PER_MODULE 40
+#define ROUNDS 5
+
+static const char *function_template =
+    "f! handler_%d_%d(request, count) {\n"
+    "    status = 200\n"
+    "    total = count * 3 + %d %% 7\n"
+    "    if total >= 10 { total = total - 1 } else { total = total + 1 }\n"
+    "    while count > 0 {\n"
+    "        count = count - 1\n"
+    "        if count == 5 { break }\n"
+    "    }\n"
+    "    # summarize the request before replying\n"
+    "    body = \"{\\\"status\\\": \" + status + \", \\\"total\\\": \" + total + \"}\"\n"
+    "    print:: \"handled\", body\n"
+    "    ret body\n"
+    "}\n";
+
+static char paths[MODULE_COUNT][1024];
+
+static void write_modules(const char *dir) {
+    for (int i = 0; i < MODULE_COUNT; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "%s/startup_%d.tess", dir, i);
+        FILE *file = fopen(paths[i], "w");
+        if (!file) {
+            fprintf(stderr, "Error: Cannot write '%s'\n", paths[i]);
+            exit(1);
+        }
+        for (int j = 0; j < FUNCTIONS_PER_MODULE; j++) {
+            fprintf(file, function_template, i, j, j);
+        }
+        fclose(file);
+    }
+}
+
+static void remove_caches(void) {
+    char cache[sizeof(paths[0]) + 1];
+    for (int i = 0; i < MODULE_COUNT; i++) {
+        size_t length = strlen(paths[i]);
+        memcpy(cache, paths[i], length);
+        cache[length] = 'c';
+        cache[length + 1] = '\0';
+        remove(cache);
+    }
+}
+
+static double parse_all(void) {
+    clock_t start = clock();
+    for (int i = 0; i < MODULE_COUNT; i++) {
+        Arena *arena = arena_create();
+        if (!module_cache_parse(paths[i], arena)) {
+            fprintf(stderr, "Error: Cannot open '%s'\n", paths[i]);
+            exit(1);
+        }
+        arena_destroy(arena);
+    }
+    return (double)(clock() - start) / CLOCKS_PER_SEC * 1000.0;
+}
+
+static void report(const char *name, int enabled, int cold) {
+    double best = 0;
+    module_cache_set_enabled(enabled);
+    for (int round = 0; round < ROUNDS; round++) {
+        if (cold) remove_caches();
+        double elapsed = parse_all();
+        if (round == 0 || elapsed < best) best = elapsed;
+    }
+    printf("%-9s %8.2f ms  (%d modules)\n", name, best, MODULE_COUNT);
+}
+
+int main(int argc, char *argv[]) {
+    write_modules(argc > 1 ? argv[1] : ".");
+    remove_caches();
+    report("no-cache", 0, 0);
+    report("cold", 1, 1);
+    report("warm", 1, 0);
+    remove_caches();
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tess_alloc.h"
+
+static size_t alloc_bytes = 0;
+static size_t alloc_count = 0;
+
+void* tess_malloc(size_t size) {
+    alloc_bytes += size;
+    alloc_count++;
+    return malloc(size);
+}
+
+void* tess_calloc(size_t count, size_t size) {
+    alloc_bytes += count * size;
+    alloc_count++;
+    return calloc(count, size);
+}
+
+void* tess_realloc(void *ptr, size_t size) {
+    alloc_bytes += size;
+    alloc_count++;
+    return realloc(ptr, size);
+}
+
+char* tess_strdup(const char *str) {
+    size_t size = strlen(str) + 1;
+    char *copy = tess_malloc(size);
+    memcpy(copy, str, size);
+    return copy;
+}
+
+size_t tess_alloc_bytes(void) {
+    return alloc_bytes;
+}
+
+size_t tess_alloc_count(void) {
+    return alloc_count;
+}
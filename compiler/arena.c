@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "string_pool.h"
+#include "tess_alloc.h"
+
+#define ARENA_CHUNK_SIZE 65536
+#define ARENA_ALIGN 8
+
+struct ArenaChunk {
+    ArenaChunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+struct ArenaString {
+    ArenaString *next;
+    const char *str;
+};
+
+Arena* arena_create(void) {
+    Arena *arena = tess_malloc(sizeof(Arena));
+    arena->chunks = NULL;
+    arena->interned = NULL;
+    return arena;
+}
+
+void arena_destroy(Arena *arena) {
+    if (!arena) return;
+    for (ArenaString *s = arena->interned; s; s = s->next) {
+        string_pool_release(s->str);
+    }
+    ArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
+
+void* arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaChunk *chunk = arena->chunks;
+    if (!chunk || chunk->size - chunk->used < size) {
+        size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        chunk = tess_malloc(sizeof(ArenaChunk) + chunk_size);
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        /* An oversized block goes behind the current chunk so its free
+         * space stays in use. */
+        if (arena->chunks && size > ARENA_CHUNK_SIZE) {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            chunk->next = arena->chunks;
+            arena->chunks = chunk;
+        }
+    }
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+char* arena_strndup(Arena *arena, const char *chars, size_t length) {
+    char *copy = arena_alloc(arena, length + 1);
+    memcpy(copy, chars, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+char* arena_strdup(Arena *arena, const char *str) {
+    return arena_strndup(arena, str, strlen(str));
+}
+
+const char* arena_intern(Arena *arena, const char *chars, size_t length) {
+    ArenaString *s = arena_alloc(arena, sizeof(ArenaString));
+    s->str = string_pool_intern(chars, length);
+    s->next = arena->interned;
+    arena->interned = s;
+    return s->str;
+}
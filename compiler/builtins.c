@@ -13,8 +13,10 @@
 #endif
 #include "interpreter.h"
 #include "tess_stdlib.h"
-
-typedef Value (*BuiltinFunc)(Value *args, int argc);
+#include "tess_alloc.h"
+#include "tess_string.h"
+#include "dict.h"
+#include "shape.h"
 
 typedef struct {
     char *name;
@@ -32,6 +34,9 @@ static Value math_abs(Value *args, int argc);
 static Value math_max(Value *args, int argc);
 static Value math_min(Value *args, int argc);
 static Value get_timing(Value *args, int argc);
+static Value get_alloc_bytes(Value *args, int argc);
+static Value get_alloc_count(Value *args, int argc);
+static Value get_gc_stats(Value *args, int argc);
 
 static BuiltinFunction builtins[] = {
     {"read_file", (BuiltinFunc)stdlib_read_file},
@@ -52,98 +57,82 @@ static BuiltinFunction builtins[] = {
     {"json_format", (BuiltinFunc)stdlib_json_format},
     {"clock", (BuiltinFunc)stdlib_clock},
     {"timing", (BuiltinFunc)get_timing},
+    {"alloc_bytes", (BuiltinFunc)get_alloc_bytes},
+    {"alloc_count", (BuiltinFunc)get_alloc_count},
+    {"gc_stats", (BuiltinFunc)get_gc_stats},
     {NULL, NULL}
 };
 
 static Value str_len(Value *args, int argc) {
-    Value result = {VALUE_NUMBER, {0}};
-    if (argc < 1 || args[0].type != VALUE_STRING) {
-        return result;
+    if (argc < 1 || value_type(args[0]) != VALUE_STRING) {
+        return value_number(0);
     }
-    result.as.number = strlen(args[0].as.string);
-    return result;
+    return value_number(string_length(value_as_string(args[0])));
 }
 
 static Value str_slice(Value *args, int argc) {
-    Value result = {VALUE_STRING, {0}};
-    if (argc < 3 || args[0].type != VALUE_STRING) {
-        result.type = VALUE_NULL;
-        return result;
+    if (argc < 3 || value_type(args[0]) != VALUE_STRING) {
+        return value_null();
     }
-    char *str = args[0].as.string;
-    int start = (int)args[1].as.number;
-    int end = (int)args[2].as.number;
-    int len = strlen(str);
+    char *str = value_as_string(args[0]);
+    int start = (int)value_as_number(args[1]);
+    int end = (int)value_as_number(args[2]);
+    int len = (int)string_length(str);
     
     if (start < 0) start = len + start;
     if (end < 0) end = len + end;
     if (start < 0) start = 0;
     if (end > len) end = len;
     if (start > end) {
-        result.as.string = strdup("");
-        return result;
+        return value_string(gc_substring(str, 0));
     }
     
-    int slice_len = end - start;
-    result.as.string = malloc(slice_len + 1);
-    memcpy(result.as.string, str + start, slice_len);
-    result.as.string[slice_len] = '\0';
-    return result;
+    return value_string(gc_substring(str + start, end - start));
 }
 
 static Value str_replace(Value *args, int argc) {
-    Value result = {VALUE_STRING, {0}};
-    if (argc < 3 || args[0].type != VALUE_STRING || args[1].type != VALUE_STRING || args[2].type != VALUE_STRING) {
-        result.type = VALUE_NULL;
-        return result;
+    if (argc < 3 || value_type(args[0]) != VALUE_STRING || value_type(args[1]) != VALUE_STRING || value_type(args[2]) != VALUE_STRING) {
+        return value_null();
     }
-    char *str = args[0].as.string;
-    char *old = args[1].as.string;
-    char *new = args[2].as.string;
-    
-    size_t result_len = strlen(str) + 1;
-    char *result_str = malloc(result_len);
-    strcpy(result_str, str);
+    char *str = value_as_string(args[0]);
+    char *old = value_as_string(args[1]);
+    char *new = value_as_string(args[2]);
     
-    char *pos = strstr(result_str, old);
-    if (pos) {
-        size_t old_len = strlen(old);
-        size_t new_len = strlen(new);
-        size_t tail_len = strlen(pos + old_len);
-        result_len = (pos - result_str) + new_len + tail_len + 1;
-        char *new_str = malloc(result_len);
-        memcpy(new_str, result_str, pos - result_str);
-        memcpy(new_str + (pos - result_str), new, new_len);
-        strcpy(new_str + (pos - result_str) + new_len, pos + old_len);
-        free(result_str);
-        result_str = new_str;
+    char *pos = strstr(str, old);
+    if (!pos) {
+        return args[0];
     }
-    result.as.string = result_str;
-    return result;
+    
+    size_t prefix_len = pos - str;
+    size_t old_len = string_length(old);
+    size_t new_len = string_length(new);
+    size_t tail_len = string_length(str) - prefix_len - old_len;
+    char *result_str = gc_string(prefix_len + new_len + tail_len);
+    memcpy(result_str, str, prefix_len);
+    memcpy(result_str + prefix_len, new, new_len);
+    memcpy(result_str + prefix_len + new_len, pos + old_len, tail_len);
+    return value_string(result_str);
 }
 
 static Value list_append(Value *args, int argc) {
-    Value result = {VALUE_NULL, {0}};
-    if (argc < 2 || args[0].type != VALUE_LIST) {
-        return result;
+    if (argc < 2 || value_type(args[0]) != VALUE_LIST) {
+        return value_null();
     }
-    List *list = args[0].as.list;
+    List *list = value_as_list(args[0]);
     if (list->count >= list->capacity) {
         list->capacity *= 2;
-        list->items = realloc(list->items, sizeof(Value) * list->capacity);
+        list->items = tess_realloc(list->items, sizeof(Value) * list->capacity);
     }
     list->items[list->count++] = args[1];
-    result.type = VALUE_NUMBER;
-    result.as.number = 1;
-    return result;
+    return value_number(1);
 }
 
 static Value list_pop(Value *args, int argc) {
-    Value result = {VALUE_NULL, {0}};
-    if (argc < 1 || args[0].type != VALUE_LIST) {
+    Value result = value_null();
+    if (argc < 1 || value_type(args[0]) != VALUE_LIST) {
         return result;
     }
-    List *list = args[0].as.list;
+    List *list = value_as_list(args[0]);
     if (list->count > 0) {
         result = list->items[--list->count];
     }
@@ -151,86 +140,62 @@ static Value list_pop(Value *args, int argc) {
 }
 
 static Value dict_keys(Value *args, int argc) {
-    Value result = {VALUE_LIST, {0}};
-    if (argc < 1 || args[0].type != VALUE_DICT) {
-        result.type = VALUE_NULL;
-        return result;
+    if (argc < 1 || value_type(args[0]) != VALUE_DICT) {
+        return value_null();
     }
-    Dict *dict = args[0].as.dict;
-    List *list = malloc(sizeof(List));
-    list->count = 0;
-    list->capacity = dict->count;
-    list->items = malloc(sizeof(Value) * list->capacity);
+    Dict *dict = value_as_dict(args[0]);
+    List *list = gc_new_list(dict->count);
     
-    for (size_t i = 0; i < dict->bucket_count; i++) {
-        DictEntry *entry = dict->buckets[i];
-        while (entry) {
-            Value key_val = {VALUE_STRING, {0}};
-            key_val.as.string = strdup(entry->key);
-            list->items[list->count++] = key_val;
-            entry = entry->next;
-        }
+    for (size_t i = 0; i < dict->count; i++) {
+        list->items[list->count++] = value_string(dict->entries[i].key);
     }
-    result.as.list = list;
-    return result;
+    return value_list(list);
 }
 
 static Value dict_values(Value *args, int argc) {
-    Value result = {VALUE_LIST, {0}};
-    if (argc < 1 || args[0].type != VALUE_DICT) {
-        result.type = VALUE_NULL;
-        return result;
+    if (argc < 1 || value_type(args[0]) != VALUE_DICT) {
+        return value_null();
     }
-    Dict *dict = args[0].as.dict;
-    List *list = malloc(sizeof(List));
-    list->count = 0;
-    list->capacity = dict->count;
-    list->items = malloc(sizeof(Value) * list->capacity);
+    Dict *dict = value_as_dict(args[0]);
+    List *list = gc_new_list(dict->count);
     
-    for (size_t i = 0; i < dict->bucket_count; i++) {
-        DictEntry *entry = dict->buckets[i];
-        while (entry) {
-            list->items[list->count++] = *entry->value;
-            entry = entry->next;
-        }
+    for (size_t i = 0; i < dict->count; i++) {
+        list->items[list->count++] = dict->entries[i].value;
     }
-    result.as.list = list;
-    return result;
+    return value_list(list);
 }
 
 static Value math_abs(Value *args, int argc) {
-    Value result = {VALUE_NUMBER, {0}};
-    if (argc < 1 || args[0].type != VALUE_NUMBER) {
-        return result;
+    if (argc < 1 || value_type(args[0]) != VALUE_NUMBER) {
+        return value_number(0);
     }
-    result.as.number = fabs(args[0].as.number);
-    return result;
+    return value_number(fabs(value_as_number(args[0])));
 }
 
 static Value math_max(Value *args, int argc) {
-    Value result = {VALUE_NUMBER, {0}};
-    if (argc < 1) return result;
-    double max_val = args[0].type == VALUE_NUMBER ? args[0].as.number : 0;
+    if (argc < 1) return value_number(0);
+    double max_val = value_type(args[0]) == VALUE_NUMBER ? value_as_number(args[0]) : 0;
     for (int i = 1; i < argc; i++) {
-        if (args[i].type == VALUE_NUMBER && args[i].as.number > max_val) {
-            max_val = args[i].as.number;
+        if (value_type(args[i]) == VALUE_NUMBER && value_as_number(args[i]) > max_val) {
+            max_val = value_as_number(args[i]);
         }
     }
-    result.as.number = max_val;
-    return result;
+    return value_number(max_val);
 }
 
 static Value math_min(Value *args, int argc) {
-    Value result = {VALUE_NUMBER, {0}};
-    if (argc < 1) return result;
-    double min_val = args[0].type == VALUE_NUMBER ? args[0].as.number : 0;
+    if (argc < 1) return value_number(0);
+    double min_val = value_type(args[0]) == VALUE_NUMBER ? value_as_number(args[0]) : 0;
     for (int i = 1; i < argc; i++) {
-        if (args[i].type == VALUE_NUMBER && args[i].as.number < min_val) {
-            min_val = args[i].as.number;
+        if (value_type(args[i]) == VALUE_NUMBER && value_as_number(args[i]) < min_val) {
+            min_val = value_as_number(args[i]);
         }
     }
-    result.as.number = min_val;
-    return result;
+    return value_number(min_val);
+}
+
+static void builtin_dict_set(Dict *dict, const char *key, Value value) {
+    dict_set(dict, gc_strdup(key), value);
 }
 
 static Value get_timing(Value *args, int argc) {
@@ -239,60 +204,52 @@ static Value get_timing(Value *args, int argc) {
     
     extern double g_compile_time, g_execute_time, g_total_time;
     
-    Value result = {VALUE_DICT, {0}};
-    Dict *dict = malloc(sizeof(Dict));
-    dict->bucket_count = 8;
-    dict->count = 0;
-    dict->buckets = calloc(dict->bucket_count, sizeof(DictEntry*));
-    
-    Value compile_val = {VALUE_NUMBER, {0}};
-    compile_val.as.number = g_compile_time;
-    DictEntry *compile_entry = malloc(sizeof(DictEntry));
-    compile_entry->key = strdup("compile_time");
-    compile_entry->value = malloc(sizeof(Value));
-    *compile_entry->value = compile_val;
-    compile_entry->next = NULL;
-    unsigned long hash = 5381;
-    char *k = compile_entry->key;
-    int c;
-    while ((c = *k++)) hash = ((hash << 5) + hash) + c;
-    size_t bucket_idx = hash % dict->bucket_count;
-    compile_entry->next = dict->buckets[bucket_idx];
-    dict->buckets[bucket_idx] = compile_entry;
-    dict->count++;
+    Dict *dict = gc_new_dict(3);
+    builtin_dict_set(dict, "compile_time", value_number(g_compile_time));
+    builtin_dict_set(dict, "execute_time", value_number(g_execute_time));
+    builtin_dict_set(dict, "total_time", value_number(g_total_time));
+    return value_dict(dict);
+}
+
+static Value get_alloc_bytes(Value *args, int argc) {
+    (void)args;
+    (void)argc;
+    return value_number((double)tess_alloc_bytes());
+}
+
+static Value get_alloc_count(Value *args, int argc) {
+    (void)args;
+    (void)argc;
+    return value_number((double)tess_alloc_count());
+}
+
+static Value get_gc_stats(Value *args, int argc) {
+    (void)args;
+    (void)argc;
     
-    Value execute_val = {VALUE_NUMBER, {0}};
-    execute_val.as.number = g_execute_time;
-    DictEntry *execute_entry = malloc(sizeof(DictEntry));
-    execute_entry->key = strdup("execute_time");
-    execute_entry->value = malloc(sizeof(Value));
-    *execute_entry->value = execute_val;
-    execute_entry->next = NULL;
-    hash = 5381;
-    k = execute_entry->key;
-    while ((c = *k++)) hash = ((hash << 5) + hash) + c;
-    bucket_idx = hash % dict->bucket_count;
-    execute_entry->next = dict->buckets[bucket_idx];
-    dict->buckets[bucket_idx] = execute_entry;
-    dict->count++;
+    static const char *names[] = {
+        "collections", "pause_total_ms", "pause_max_ms", "live_bytes", "heap_bytes", "objects", "threshold"
+    };
+    static Shape *shape = NULL;
+    if (!shape) {
+        shape = shape_create();
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            shape_add_field(shape, names[i]);
+        }
+    }
     
-    Value total_val = {VALUE_NUMBER, {0}};
-    total_val.as.number = g_total_time;
-    DictEntry *total_entry = malloc(sizeof(DictEntry));
-    total_entry->key = strdup("total_time");
-    total_entry->value = malloc(sizeof(Value));
-    *total_entry->value = total_val;
-    total_entry->next = NULL;
-    hash = 5381;
-    k = total_entry->key;
-    while ((c = *k++)) hash = ((hash << 5) + hash) + c;
-    bucket_idx = hash % dict->bucket_count;
-    total_entry->next = dict->buckets[bucket_idx];
-    dict->buckets[bucket_idx] = total_entry;
-    dict->count++;
+    GCStats stats;
+    gc_get_stats(&stats);
     
-    result.as.dict = dict;
-    return result;
+    Object *object = gc_new_object(shape);
+    object->fields[0] = value_number((double)stats.collections);
+    object->fields[1] = value_number(stats.pause_total * 1000.0);
+    object->fields[2] = value_number(stats.pause_max * 1000.0);
+    object->fields[3] = value_number((double)stats.live_bytes);
+    object->fields[4] = value_number((double)stats.heap_bytes);
+    object->fields[5] = value_number((double)stats.objects);
+    object->fields[6] = value_number((double)stats.threshold);
+    return value_object(object);
 }
 
 BuiltinFunc get_builtin(const char *name) {
@@ -337,94 +294,27 @@ BuiltinFunc get_builtin(const char *name) {
     return NULL;
 }
 
-void register_builtins(Interpreter *interpreter) {
-    for (int i = 0; builtins[i].name; i++) {
-        Value func_val = {VALUE_FUNCTION, {0}};
-        func_val.as.function = NULL;
-        interpreter_set_variable(interpreter, builtins[i].name, func_val);
+/* An object whose methods all dispatch to the builtin of the same name. */
+static Value builtin_namespace(const char **methods) {
+    Shape *shape = shape_create();
+    for (; *methods; methods++) {
+        shape_add_method(shape, *methods, value_function(NULL));
     }
-    
-    Value f_obj = {VALUE_OBJECT, {0}};
-    Dict *f_dict = malloc(sizeof(Dict));
-    f_dict->bucket_count = 8;
-    f_dict->count = 0;
-    f_dict->buckets = calloc(8, sizeof(DictEntry*));
-    
-    Value open_func = {VALUE_FUNCTION, {0}};
-    open_func.as.function = NULL;
-    
-    DictEntry *entry = malloc(sizeof(DictEntry));
-    entry->key = strdup("open");
-    entry->value = malloc(sizeof(Value));
-    *entry->value = open_func;
-    entry->next = NULL;
-    
-    unsigned long hash = 5381;
-    char *k = "open";
-    int c;
-    while ((c = *k++)) hash = ((hash << 5) + hash) + c;
-    size_t idx = hash % 8;
-    f_dict->buckets[idx] = entry;
-    
-    f_obj.as.dict = f_dict;
-    interpreter_set_variable(interpreter, "f", f_obj);
-
-    Value mem_obj = {VALUE_OBJECT, {0}};
-    Dict *mem_dict = malloc(sizeof(Dict));
-    mem_dict->bucket_count = 8;
-    mem_dict->count = 0;
-    mem_dict->buckets = calloc(8, sizeof(DictEntry*));
+    return value_object(gc_new_object(shape));
+}
 
-    void add_mem_method(const char *key, Dict *target_dict) {
-        Value func = {VALUE_FUNCTION, {0}};
-        func.as.function = NULL;
-        
-        DictEntry *e = malloc(sizeof(DictEntry));
-        e->key = strdup(key);
-        e->value = malloc(sizeof(Value));
-        *e->value = func;
-        e->next = NULL;
-        
-        unsigned long h = 5381;
-        const char *str = key;
-        int ch;
-        while ((ch = *str++)) h = ((h << 5) + h) + ch;
-        size_t i = h % 8;
-        
-        e->next = target_dict->buckets[i];
-        target_dict->buckets[i] = e;
-        target_dict->count++;
+void register_builtins(Interpreter *interpreter) {
+    for (int i = 0; builtins[i].name; i++) {
+        interpreter_set_variable(interpreter, builtins[i].name, value_function(NULL));
     }
-
-    add_mem_method("alloc", mem_dict);
-    add_mem_method("free", mem_dict);
-    add_mem_method("set", mem_dict);
-    add_mem_method("get", mem_dict);
-
-    mem_obj.as.dict = mem_dict;
-    interpreter_set_variable(interpreter, "mem", mem_obj);
-    
-    Value sys_obj = {VALUE_OBJECT, {0}};
-    Dict *sys_dict = malloc(sizeof(Dict));
-    sys_dict->bucket_count = 8;
-    sys_dict->count = 0;
-    sys_dict->buckets = calloc(8, sizeof(DictEntry*));
-    
-    add_mem_method("sleep", sys_dict);
-    add_mem_method("exit", sys_dict);
-    
-    sys_obj.as.dict = sys_dict;
-    interpreter_set_variable(interpreter, "sys", sys_obj);
-    
-    Value asm_obj = {VALUE_OBJECT, {0}};
-    Dict *asm_dict = malloc(sizeof(Dict));
-    asm_dict->bucket_count = 8;
-    asm_dict->count = 0;
-    asm_dict->buckets = calloc(8, sizeof(DictEntry*));
     
-    add_mem_method("alloc_exec", asm_dict);
-    add_mem_method("exec", asm_dict);
+    static const char *f_methods[] = {"open", NULL};
+    static const char *mem_methods[] = {"alloc", "free", "set", "get", NULL};
+    static const char *sys_methods[] = {"sleep", "exit", NULL};
+    static const char *asm_methods[] = {"alloc_exec", "exec", NULL};
     
-    asm_obj.as.dict = asm_dict;
-    interpreter_set_variable(interpreter, "asm", asm_obj);
+    interpreter_set_variable(interpreter, "f", builtin_namespace(f_methods));
+    interpreter_set_variable(interpreter, "mem", builtin_namespace(mem_methods));
+    interpreter_set_variable(interpreter, "sys", builtin_namespace(sys_methods));
+    interpreter_set_variable(interpreter, "asm", builtin_namespace(asm_methods));
 }
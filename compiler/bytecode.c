@@ -0,0 +1,724 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bytecode.h"
+#include "tess_alloc.h"
+#include "inline_cache.h"
+#include "string_pool.h"
+
+typedef struct Loop {
+    size_t continue_target;
+    size_t *breaks;
+    size_t break_count;
+    size_t break_capacity;
+    int try_depth;
+    struct Loop *enclosing;
+} Loop;
+
+typedef struct {
+    Proto *proto;
+    int free_reg;
+    int *scope_bases;
+    int scope_count;
+    int scope_capacity;
+    int try_depth;
+    Loop *loop;
+    int failed;
+} Compiler;
+
+static void compile_statement(Compiler *c, ASTNode *node);
+static void compile_expression(Compiler *c, ASTNode *node, int dst);
+static Proto* compile_function(Compiler *parent, ASTNode *func_node);
+
+static Proto* proto_create(const char *name) {
+    Proto *proto = malloc(sizeof(Proto));
+    proto->name = tess_strdup(name ? name : "<main>");
+    proto->code = NULL;
+    proto->code_count = 0;
+    proto->code_capacity = 0;
+    proto->constants = NULL;
+    proto->constant_count = 0;
+    proto->constant_capacity = 0;
+    proto->protos = NULL;
+    proto->proto_count = 0;
+    proto->proto_capacity = 0;
+    proto->builtins = NULL;
+    proto->builtin_count = 0;
+    proto->builtin_capacity = 0;
+    proto->caches = NULL;
+    proto->cache_count = 0;
+    proto->cache_capacity = 0;
+    proto->param_count = 0;
+    proto->register_count = 1;
+    proto->handler_count = 0;
+    return proto;
+}
+
+void bytecode_destroy(Proto *proto) {
+    if (!proto) return;
+    for (size_t i = 0; i < proto->constant_count; i++) {
+        if (value_type(proto->constants[i]) == VALUE_STRING) {
+            string_pool_release(value_as_string(proto->constants[i]));
+        }
+    }
+    for (size_t i = 0; i < proto->proto_count; i++) {
+        bytecode_destroy(proto->protos[i]);
+    }
+    free(proto->constants);
+    free(proto->protos);
+    free(proto->builtins);
+    free(proto->caches);
+    free(proto->code);
+    free(proto->name);
+    free(proto);
+}
+
+/* Operands are 16 bits wide; a function needing more registers, constants
+ * or arguments than that fails to compile rather than wrapping around. */
+static size_t emit(Compiler *c, OpCode op, int a, int b, int cc) {
+    Proto *proto = c->proto;
+    if (a < 0 || a > UINT16_MAX || b < 0 || b > UINT16_MAX || cc < 0 || cc > UINT16_MAX) {
+        if (!c->failed) {
+            fprintf(stderr, "Error: Function '%s' is too large to compile (operand exceeds %d)\n", proto->name, UINT16_MAX);
+        }
+        c->failed = 1;
+        a = b = cc = 0;
+    }
+    if (proto->code_count >= proto->code_capacity) {
+        proto->code_capacity = proto->code_capacity == 0 ? 32 : proto->code_capacity * 2;
+        proto->code = realloc(proto->code, sizeof(Instruction) * proto->code_capacity);
+    }
+    Instruction *ins = &proto->code[proto->code_count];
+    ins->op = (uint16_t)op;
+    ins->a = (uint16_t)a;
+    ins->b = (uint16_t)b;
+    ins->c = (uint16_t)cc;
+    return proto->code_count++;
+}
+
+static size_t emit_jump(Compiler *c, OpCode op, int a) {
+    size_t at = emit(c, op, a, 0, 0);
+    c->proto->code[at].target = 0;
+    return at;
+}
+
+static void patch_jump(Compiler *c, size_t at, size_t target) {
+    c->proto->code[at].target = (uint32_t)target;
+}
+
+static size_t here(Compiler *c) {
+    return c->proto->code_count;
+}
+
+static int add_constant(Compiler *c, Value value) {
+    Proto *proto = c->proto;
+    for (size_t i = 0; i < proto->constant_count; i++) {
+        Value k = proto->constants[i];
+        if (value_type(k) != value_type(value)) continue;
+        if (value_type(value) == VALUE_NUMBER && value_as_number(k) == value_as_number(value)) return (int)i;
+        if (value_type(value) == VALUE_STRING && strcmp(value_as_string(k), value_as_string(value)) == 0) return (int)i;
+        if (value_type(value) == VALUE_FUNCTION && value_as_function(k) == value_as_function(value)) return (int)i;
+        if (value_type(value) == VALUE_CLASS && value_as_class(k) == value_as_class(value)) return (int)i;
+    }
+
+    if (proto->constant_count >= proto->constant_capacity) {
+        proto->constant_capacity = proto->constant_capacity == 0 ? 8 : proto->constant_capacity * 2;
+        proto->constants = realloc(proto->constants, sizeof(Value) * proto->constant_capacity);
+    }
+    if (value_type(value) == VALUE_STRING) {
+        const char *chars = value_as_string(value);
+        value = value_string(string_pool_intern(chars, strlen(chars)));
+    }
+    proto->constants[proto->constant_count] = value;
+    return (int)proto->constant_count++;
+}
+
+static int string_constant(Compiler *c, const char *str) {
+    return add_constant(c, value_string(str));
+}
+
+static int add_builtin(Compiler *c, BuiltinFunc builtin) {
+    Proto *proto = c->proto;
+    for (size_t i = 0; i < proto->builtin_count; i++) {
+        if (proto->builtins[i] == builtin) return (int)i;
+    }
+    if (proto->builtin_count >= proto->builtin_capacity) {
+        proto->builtin_capacity = proto->builtin_capacity == 0 ? 4 : proto->builtin_capacity * 2;
+        proto->builtins = realloc(proto->builtins, sizeof(BuiltinFunc) * proto->builtin_capacity);
+    }
+    proto->builtins[proto->builtin_count] = builtin;
+    return (int)proto->builtin_count++;
+}
+
+static int add_cache(Compiler *c, ASTNode *node) {
+    Proto *proto = c->proto;
+    if (proto->cache_count >= proto->cache_capacity) {
+        proto->cache_capacity = proto->cache_capacity == 0 ? 4 : proto->cache_capacity * 2;
+        proto->caches = realloc(proto->caches, sizeof(InlineCache*) * proto->cache_capacity);
+    }
+    proto->caches[proto->cache_count] = inline_cache_for(node);
+    return (int)proto->cache_count++;
+}
+
+static int reserve_register(Compiler *c) {
+    int reg = c->free_reg++;
+    if (c->free_reg > c->proto->register_count) {
+        c->proto->register_count = c->free_reg;
+    }
+    return reg;
+}
+
+static void free_registers(Compiler *c, int count) {
+    c->free_reg -= count;
+}
+
+/* Locals of each open block live in a run of registers starting at its base. */
+static void open_scope(Compiler *c, int slot_count) {
+    if (c->scope_count >= c->scope_capacity) {
+        c->scope_capacity = c->scope_capacity == 0 ? 8 : c->scope_capacity * 2;
+        c->scope_bases = realloc(c->scope_bases, sizeof(int) * c->scope_capacity);
+    }
+    c->scope_bases[c->scope_count++] = c->free_reg;
+    for (int i = 0; i < slot_count; i++) {
+        reserve_register(c);
+    }
+}
+
+static void close_scope(Compiler *c) {
+    c->free_reg = c->scope_bases[--c->scope_count];
+}
+
+static int local_register(Compiler *c, ASTNode *node) {
+    return c->scope_bases[c->scope_count - 1 - node->depth] + node->slot;
+}
+
+static void compile_load(Compiler *c, ASTNode *node, int dst) {
+    if (node->depth >= 0) {
+        int reg = local_register(c, node);
+        if (reg != dst) emit(c, OP_MOVE, dst, reg, 0);
+    } else {
+        emit(c, OP_GETGLOBAL, dst, node->slot, 0);
+    }
+}
+
+static void compile_store(Compiler *c, ASTNode *node, int src) {
+    if (node->depth >= 0) {
+        int reg = local_register(c, node);
+        if (reg != src) emit(c, OP_MOVE, reg, src, 0);
+    } else {
+        emit(c, OP_SETGLOBAL, src, node->slot, 0);
+    }
+}
+
+static int is_expression(ASTNode *node) {
+    switch (node->type) {
+        case AST_NUMBER:
+        case AST_STRING:
+        case AST_IDENTIFIER:
+        case AST_BINARY_OP:
+        case AST_ASSIGNMENT:
+        case AST_FUNCTION_CALL:
+        case AST_MAIN_CALL:
+        case AST_MEMBER_ACCESS:
+        case AST_NEW:
+        case AST_LIST:
+        case AST_DICT:
+        case AST_INDEX:
+        case AST_PRINT:
+        case AST_HTTP_REQUEST:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static OpCode binary_opcode(BinaryOperator op) {
+    switch (op) {
+        case BINOP_ADD: return OP_ADD;
+        case BINOP_SUB: return OP_SUB;
+        case BINOP_MUL: return OP_MUL;
+        case BINOP_DIV: return OP_DIV;
+        case BINOP_MOD: return OP_MOD;
+        case BINOP_GT: return OP_GT;
+        case BINOP_LT: return OP_LT;
+        case BINOP_EQ: return OP_EQ;
+        case BINOP_NEQ: return OP_NEQ;
+        case BINOP_GTE: return OP_GTE;
+        case BINOP_LTE: return OP_LTE;
+    }
+    return OP_LOADNULL;
+}
+
+static int compile_arguments(Compiler *c, ASTNode *arg) {
+    int argc = 0;
+    while (arg) {
+        int reg = reserve_register(c);
+        compile_expression(c, arg, reg);
+        argc++;
+        arg = arg->next;
+    }
+    return argc;
+}
+
+/* Locals are read in place; anything else is evaluated into a new temporary. */
+static int compile_operand(Compiler *c, ASTNode *node, int *temps) {
+    if (node && node->type == AST_IDENTIFIER && node->depth >= 0) {
+        return local_register(c, node);
+    }
+    int reg = reserve_register(c);
+    compile_expression(c, node, reg);
+    (*temps)++;
+    return reg;
+}
+
+static void compile_append_operands(Compiler *c, ASTNode *sum) {
+    if (sum->left->type == AST_BINARY_OP) {
+        compile_append_operands(c, sum->left);
+    }
+    compile_expression(c, sum->right, reserve_register(c));
+}
+
+/* x = x + a + b ... on a local: a, b, ... go into consecutive temporaries
+ * and one OP_APPEND extends x's register. */
+static void compile_appends(Compiler *c, ASTNode *node, int reg) {
+    int base = c->free_reg;
+    compile_append_operands(c, node->right);
+    emit(c, OP_APPEND, reg, base, node->appends);
+    free_registers(c, node->appends);
+}
+
+static void compile_expression(Compiler *c, ASTNode *node, int dst) {
+    if (!node) {
+        emit(c, OP_LOADNULL, dst, 0, 0);
+        return;
+    }
+
+    switch (node->type) {
+        case AST_NUMBER: {
+            Value number = value_number(node->number);
+            emit(c, OP_LOADK, dst, add_constant(c, number), 0);
+            return;
+        }
+
+        case AST_STRING:
+            emit(c, OP_LOADK, dst, string_constant(c, node->value), 0);
+            return;
+
+        case AST_IDENTIFIER:
+            compile_load(c, node, dst);
+            return;
+
+        case AST_BINARY_OP: {
+            OpCode op = binary_opcode(node->op);
+            int temps = 0;
+            int left = compile_operand(c, node->left, &temps);
+            int right = compile_operand(c, node->right, &temps);
+            emit(c, op, dst, left, right);
+            free_registers(c, temps);
+            return;
+        }
+
+        case AST_ASSIGNMENT:
+            if (node->depth >= 0) {
+                int reg = local_register(c, node);
+                if (node->appends > 0) {
+                    compile_appends(c, node, reg);
+                } else {
+                    compile_expression(c, node->right, reg);
+                }
+                if (reg != dst) emit(c, OP_MOVE, dst, reg, 0);
+            } else {
+                compile_expression(c, node->right, dst);
+                emit(c, OP_SETGLOBAL, dst, node->slot, 0);
+            }
+            return;
+
+        case AST_FUNCTION_CALL: {
+            int base = reserve_register(c);
+            if (node->builtin) {
+                int argc = compile_arguments(c, node->left);
+                emit(c, OP_BUILTIN, base, argc, add_builtin(c, node->builtin));
+                if (dst != base) emit(c, OP_MOVE, dst, base, 0);
+                free_registers(c, argc + 1);
+                return;
+            }
+            compile_load(c, node, base);
+            int argc = compile_arguments(c, node->left);
+            emit(c, OP_CALL, base, argc, string_constant(c, node->value));
+            if (dst != base) emit(c, OP_MOVE, dst, base, 0);
+            free_registers(c, argc + 1);
+            return;
+        }
+
+        case AST_MAIN_CALL:
+            emit(c, OP_START, dst, node->slot, 0);
+            return;
+
+        case AST_MEMBER_ACCESS: {
+            int cache = add_cache(c, node);
+            int base = reserve_register(c);
+            compile_expression(c, node->left, base);
+            if (node->call) {
+                int argc = compile_arguments(c, node->children);
+                emit(c, OP_INVOKE, base, argc, cache);
+                free_registers(c, argc);
+            } else {
+                emit(c, OP_GETMEMBER, base, base, cache);
+            }
+            if (dst != base) emit(c, OP_MOVE, dst, base, 0);
+            free_registers(c, 1);
+            return;
+        }
+
+        case AST_NEW: {
+            int class_reg = node->depth >= 0 ? local_register(c, node) : reserve_register(c);
+            if (node->depth < 0) compile_load(c, node, class_reg);
+            emit(c, OP_NEW, dst, class_reg, 0);
+            if (node->depth < 0) free_registers(c, 1);
+            return;
+        }
+
+        case AST_LIST: {
+            int base = c->free_reg;
+            int count = compile_arguments(c, node->children);
+            emit(c, OP_NEWLIST, dst, base, count);
+            free_registers(c, count);
+            return;
+        }
+
+        case AST_DICT:
+            emit(c, OP_NEWDICT, dst, 0, 0);
+            return;
+
+        case AST_INDEX: {
+            int collection = reserve_register(c);
+            int index = reserve_register(c);
+            compile_expression(c, node->left, collection);
+            compile_expression(c, node->right, index);
+            emit(c, OP_INDEX, dst, collection, index);
+            free_registers(c, 2);
+            return;
+        }
+
+        case AST_PRINT: {
+            int base = c->free_reg;
+            int count = compile_arguments(c, node->left);
+            emit(c, OP_PRINT, base, count, 0);
+            if (count > 0) emit(c, OP_MOVE, dst, base + count - 1, 0);
+            else emit(c, OP_LOADNULL, dst, 0, 0);
+            free_registers(c, count);
+            return;
+        }
+
+        case AST_HTTP_REQUEST: {
+            if (!node->left || !node->right) {
+                emit(c, OP_LOADK, dst, string_constant(c, "HTTP Error: Missing method or URL"), 0);
+                return;
+            }
+            int base = reserve_register(c);
+            compile_expression(c, node->left, base);
+            compile_expression(c, node->right, reserve_register(c));
+            int has_data = node->children != NULL;
+            if (has_data) compile_expression(c, node->children, reserve_register(c));
+            emit(c, OP_HTTP, dst, base, has_data);
+            free_registers(c, 2 + has_data);
+            return;
+        }
+
+        default:
+            compile_statement(c, node);
+            emit(c, OP_LOADNULL, dst, 0, 0);
+            return;
+    }
+}
+
+static void compile_block(Compiler *c, ASTNode *block) {
+    if (!block) return;
+
+    if (block->type != AST_BLOCK && block->type != AST_INNER_BLOCK) {
+        compile_statement(c, block);
+        return;
+    }
+
+    int scoped = block->type == AST_BLOCK;
+    if (scoped) open_scope(c, block->local_count);
+    for (ASTNode *stmt = block->children; stmt; stmt = stmt->next) {
+        compile_statement(c, stmt);
+    }
+    if (scoped) close_scope(c);
+}
+
+static void loop_begin(Compiler *c, Loop *loop, size_t continue_target) {
+    loop->continue_target = continue_target;
+    loop->breaks = NULL;
+    loop->break_count = 0;
+    loop->break_capacity = 0;
+    loop->try_depth = c->try_depth;
+    loop->enclosing = c->loop;
+    c->loop = loop;
+}
+
+static void loop_end(Compiler *c, Loop *loop) {
+    size_t end = here(c);
+    for (size_t i = 0; i < loop->break_count; i++) {
+        patch_jump(c, loop->breaks[i], end);
+    }
+    free(loop->breaks);
+    c->loop = loop->enclosing;
+}
+
+/* Leaving the loop from inside a try drops the handlers the loop body
+ * pushed, as falling off the end of each try block would. */
+static void compile_loop_exit(Compiler *c, int is_break) {
+    Loop *loop = c->loop;
+    if (!loop) return;
+
+    for (int i = loop->try_depth; i < c->try_depth; i++) {
+        emit(c, OP_ENDTRY, 0, 0, 0);
+    }
+
+    if (!is_break) {
+        size_t at = emit_jump(c, OP_JMP, 0);
+        patch_jump(c, at, loop->continue_target);
+        return;
+    }
+
+    if (loop->break_count >= loop->break_capacity) {
+        loop->break_capacity = loop->break_capacity == 0 ? 4 : loop->break_capacity * 2;
+        loop->breaks = realloc(loop->breaks, sizeof(size_t) * loop->break_capacity);
+    }
+    loop->breaks[loop->break_count++] = emit_jump(c, OP_JMP, 0);
+}
+
+static void compile_statement(Compiler *c, ASTNode *node) {
+    if (!node) return;
+
+    if (node->type == AST_ASSIGNMENT && node->depth >= 0) {
+        if (node->appends > 0) {
+            compile_appends(c, node, local_register(c, node));
+        } else {
+            compile_expression(c, node->right, local_register(c, node));
+        }
+        return;
+    }
+
+    if (is_expression(node)) {
+        int reg = reserve_register(c);
+        compile_expression(c, node, reg);
+        free_registers(c, 1);
+        return;
+    }
+
+    switch (node->type) {
+        case AST_BLOCK:
+        case AST_INNER_BLOCK:
+            compile_block(c, node);
+            return;
+
+        case AST_IF: {
+            int cond = reserve_register(c);
+            compile_expression(c, node->left, cond);
+            free_registers(c, 1);
+            size_t to_else = emit_jump(c, OP_JMPIFNOT, cond);
+            compile_block(c, node->children);
+            if (node->right) {
+                size_t to_end = emit_jump(c, OP_JMP, 0);
+                patch_jump(c, to_else, here(c));
+                compile_block(c, node->right);
+                patch_jump(c, to_end, here(c));
+            } else {
+                patch_jump(c, to_else, here(c));
+            }
+            return;
+        }
+
+        case AST_WHILE: {
+            Loop loop;
+            size_t start = here(c);
+            loop_begin(c, &loop, start);
+            int cond = reserve_register(c);
+            compile_expression(c, node->left, cond);
+            free_registers(c, 1);
+            size_t to_end = emit_jump(c, OP_JMPIFNOT, cond);
+            compile_block(c, node->children);
+            size_t back = emit_jump(c, OP_JMP, 0);
+            patch_jump(c, back, start);
+            patch_jump(c, to_end, here(c));
+            loop_end(c, &loop);
+            return;
+        }
+
+        case AST_REPEAT: {
+            Loop loop;
+            int counter = reserve_register(c);
+            compile_expression(c, node->left, counter);
+            size_t start = here(c);
+            loop_begin(c, &loop, start);
+            size_t to_end = emit_jump(c, OP_REPEAT, counter);
+            compile_block(c, node->children);
+            size_t back = emit_jump(c, OP_JMP, 0);
+            patch_jump(c, back, start);
+            patch_jump(c, to_end, here(c));
+            loop_end(c, &loop);
+            free_registers(c, 1);
+            return;
+        }
+
+        case AST_BREAK:
+            compile_loop_exit(c, 1);
+            return;
+
+        case AST_CONTINUE:
+            compile_loop_exit(c, 0);
+            return;
+
+        case AST_RETURN: {
+            int reg = reserve_register(c);
+            compile_expression(c, node->left, reg);
+            emit(c, OP_RETURN, reg, 0, 0);
+            free_registers(c, 1);
+            return;
+        }
+
+        case AST_TRY: {
+            size_t to_catch = emit_jump(c, OP_TRY, 0);
+            c->try_depth++;
+            if (c->try_depth > c->proto->handler_count) {
+                c->proto->handler_count = c->try_depth;
+            }
+            compile_block(c, node->left);
+            c->try_depth--;
+            emit(c, OP_ENDTRY, 0, 0, 0);
+            size_t to_end = emit_jump(c, OP_JMP, 0);
+            patch_jump(c, to_catch, here(c));
+            open_scope(c, node->local_count);
+            emit(c, OP_CATCH, c->scope_bases[c->scope_count - 1], 0, 0);
+            compile_block(c, node->right);
+            close_scope(c);
+            patch_jump(c, to_end, here(c));
+            return;
+        }
+
+        case AST_IMPORT:
+            if (node->value) {
+                emit(c, OP_IMPORT, 0, string_constant(c, node->value), 0);
+            }
+            return;
+
+        case AST_FUNCTION_DEF: {
+            compile_function(c, node);
+            if (!node->value) return;
+            Value func_val = value_function(node);
+            int reg = reserve_register(c);
+            emit(c, OP_LOADK, reg, add_constant(c, func_val), 0);
+            compile_store(c, node, reg);
+            free_registers(c, 1);
+            return;
+        }
+
+        case AST_CLASS_DEF: {
+            for (ASTNode *member = node->children; member; member = member->next) {
+                if (member->type == AST_FUNCTION_DEF) {
+                    compile_function(c, member);
+                }
+            }
+            if (!node->value) return;
+            Value class_val = value_class(node);
+            int reg = reserve_register(c);
+            emit(c, OP_LOADK, reg, add_constant(c, class_val), 0);
+            compile_store(c, node, reg);
+            free_registers(c, 1);
+            return;
+        }
+
+        default:
+            return;
+    }
+}
+
+static void compiler_init(Compiler *c, Proto *proto) {
+    c->proto = proto;
+    c->free_reg = 0;
+    c->scope_bases = NULL;
+    c->scope_count = 0;
+    c->scope_capacity = 0;
+    c->try_depth = 0;
+    c->loop = NULL;
+    c->failed = 0;
+}
+
+static void compile_body(Compiler *c, ASTNode *body) {
+    if (body && (body->type == AST_BLOCK || body->type == AST_INNER_BLOCK)) {
+        for (ASTNode *stmt = body->children; stmt; stmt = stmt->next) {
+            compile_statement(c, stmt);
+        }
+    } else if (body) {
+        compile_statement(c, body);
+    }
+
+    int reg = reserve_register(c);
+    emit(c, OP_LOADNULL, reg, 0, 0);
+    emit(c, OP_RETURN, reg, 0, 0);
+    free_registers(c, 1);
+}
+
+static Proto* compile_function(Compiler *parent, ASTNode *func_node) {
+    Proto *proto = bytecode_compile_function(func_node);
+    if (!proto) {
+        parent->failed = 1;
+        return NULL;
+    }
+    Proto *owner = parent->proto;
+    if (owner->proto_count >= owner->proto_capacity) {
+        owner->proto_capacity = owner->proto_capacity == 0 ? 4 : owner->proto_capacity * 2;
+        owner->protos = realloc(owner->protos, sizeof(Proto*) * owner->proto_capacity);
+    }
+    owner->protos[owner->proto_count++] = proto;
+    return proto;
+}
+
+Proto* bytecode_compile_function(ASTNode *func_node) {
+    Proto *proto = proto_create(func_node->value);
+    Compiler c;
+    compiler_init(&c, proto);
+    for (ASTNode *param = func_node->left; param; param = param->next) {
+        proto->param_count++;
+    }
+    open_scope(&c, func_node->local_count);
+    compile_body(&c, func_node->children);
+    close_scope(&c);
+    free(c.scope_bases);
+    if (c.failed) {
+        bytecode_destroy(proto);
+        return NULL;
+    }
+    func_node->proto = proto;
+    return proto;
+}
+
+Proto* bytecode_compile(ASTNode *program) {
+    Proto *proto = proto_create(NULL);
+    Compiler c;
+    compiler_init(&c, proto);
+
+    int result = reserve_register(&c);
+    emit(&c, OP_LOADNULL, result, 0, 0);
+
+    if (program && program->type == AST_PROGRAM) {
+        for (ASTNode *stmt = program->children; stmt; stmt = stmt->next) {
+            if (is_expression(stmt)) {
+                compile_expression(&c, stmt, result);
+            } else {
+                compile_statement(&c, stmt);
+            }
+        }
+    }
+
+    emit(&c, OP_RETURN, result, 0, 0);
+    free(c.scope_bases);
+    if (c.failed) {
+        bytecode_destroy(proto);
+        return NULL;
+    }
+    return proto;
+}
@@ -0,0 +1,131 @@
+#include <stdlib.h>
+#include <string.h>
+#include "dict.h"
+#include "tess_alloc.h"
+#include "tess_string.h"
+
+#define DICT_GROUP 16
+#define DICT_EMPTY 0x80
+
+#if !defined(TESS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define DICT_VECTOR
+#endif
+
+/* Bit i is set when group[i] == byte. */
+static uint32_t dict_match(const unsigned char *group, unsigned char byte) {
+#ifdef DICT_VECTOR
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < DICT_GROUP; i++) {
+        if (group[i] == byte) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/* string_hash is DJB2, whose neighbouring keys get neighbouring hashes;
+ * spread them before splitting off the group and the control byte. */
+static uint32_t dict_mix(uint32_t hash) {
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static void dict_alloc_index(Dict *dict, size_t capacity) {
+    dict->capacity = capacity;
+    dict->ctrl = tess_malloc(capacity);
+    memset(dict->ctrl, DICT_EMPTY, capacity);
+    dict->slots = tess_malloc(sizeof(uint32_t) * capacity);
+}
+
+/* Groups are probed triangularly, which visits every group once since
+ * the group count is a power of two. */
+static void dict_index_insert(Dict *dict, uint32_t hash, uint32_t entry) {
+    size_t mask = dict->capacity / DICT_GROUP - 1;
+    size_t group = (hash >> 7) & mask;
+    for (size_t step = 1;; step++) {
+        uint32_t empty = dict_match(dict->ctrl + group * DICT_GROUP, DICT_EMPTY);
+        if (empty) {
+            size_t slot = group * DICT_GROUP + __builtin_ctz(empty);
+            dict->ctrl[slot] = hash & 0x7F;
+            dict->slots[slot] = entry;
+            return;
+        }
+        group = (group + step) & mask;
+    }
+}
+
+static DictEntry* dict_lookup(Dict *dict, const char *key, uint32_t hash) {
+    size_t mask = dict->capacity / DICT_GROUP - 1;
+    size_t group = (hash >> 7) & mask;
+    for (size_t step = 1;; step++) {
+        const unsigned char *ctrl = dict->ctrl + group * DICT_GROUP;
+        for (uint32_t match = dict_match(ctrl, hash & 0x7F); match; match &= match - 1) {
+            DictEntry *entry = &dict->entries[dict->slots[group * DICT_GROUP + __builtin_ctz(match)]];
+            if (entry->key == key || strcmp(entry->key, key) == 0) {
+                return entry;
+            }
+        }
+        if (dict_match(ctrl, DICT_EMPTY)) {
+            return NULL;
+        }
+        group = (group + step) & mask;
+    }
+}
+
+void dict_init(Dict *dict, size_t count) {
+    size_t capacity = DICT_GROUP;
+    while (count * 8 > capacity * 7) capacity *= 2;
+    dict->entry_capacity = count < 4 ? 4 : count;
+    dict->entries = tess_malloc(sizeof(DictEntry) * dict->entry_capacity);
+    dict->count = 0;
+    dict_alloc_index(dict, capacity);
+}
+
+void dict_release(Dict *dict) {
+    free(dict->entries);
+    free(dict->ctrl);
+    free(dict->slots);
+}
+
+size_t dict_storage_bytes(const Dict *dict) {
+    return sizeof(DictEntry) * dict->entry_capacity + (1 + sizeof(uint32_t)) * dict->capacity;
+}
+
+Value* dict_find(Dict *dict, const char *key) {
+    DictEntry *entry = dict_lookup(dict, key, dict_mix(string_hash(key)));
+    return entry ? &entry->value : NULL;
+}
+
+void dict_set(Dict *dict, char *key, Value value) {
+    uint32_t hash = dict_mix(string_hash(key));
+    DictEntry *entry = dict_lookup(dict, key, hash);
+    if (entry) {
+        entry->value = value;
+        return;
+    }
+
+    if (dict->count >= dict->entry_capacity) {
+        dict->entry_capacity *= 2;
+        dict->entries = tess_realloc(dict->entries, sizeof(DictEntry) * dict->entry_capacity);
+    }
+    if ((dict->count + 1) * 8 > dict->capacity * 7) {
+        free(dict->ctrl);
+        free(dict->slots);
+        dict_alloc_index(dict, dict->capacity * 2);
+        for (size_t i = 0; i < dict->count; i++) {
+            dict_index_insert(dict, dict_mix(string_hash(dict->entries[i].key)), (uint32_t)i);
+        }
+    }
+
+    dict->entries[dict->count].key = key;
+    dict->entries[dict->count].value = value;
+    dict_index_insert(dict, hash, (uint32_t)dict->count);
+    dict->count++;
+}
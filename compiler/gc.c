@@ -0,0 +1,290 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "gc.h"
+#include "dict.h"
+#include "shape.h"
+#include "tess_alloc.h"
+
+#ifndef GC_MIN_HEAP
+#define GC_MIN_HEAP (1024 * 1024)
+#endif
+
+int gc_pending = 0;
+
+static GCObject *heap = NULL;
+static size_t heap_allocated = 0;
+static size_t heap_live = 0;
+static size_t heap_objects = 0;
+static size_t heap_threshold = GC_MIN_HEAP;
+static double growth_factor = 2.0;
+
+typedef struct {
+    GCObject header;
+    char chars[2];
+} CharString;
+
+_Static_assert(offsetof(CharString, chars) == sizeof(GCObject),
+               "CharString text must follow its header");
+
+/* One string per byte value, then the empty string at index 256. */
+static CharString char_strings[257];
+
+static GCObject **gray = NULL;
+static size_t gray_count = 0;
+static size_t gray_capacity = 0;
+
+static size_t collections = 0;
+static double pause_total = 0;
+static double pause_max = 0;
+
+static void gc_charge(size_t bytes) {
+    heap_allocated += bytes;
+    if (heap_live + heap_allocated >= heap_threshold) {
+        gc_pending = 1;
+    }
+}
+
+static void* gc_alloc(GCKind kind, size_t size) {
+    GCObject *object = tess_malloc(sizeof(GCObject) + size);
+    object->next = heap;
+    object->size = size;
+    object->kind = kind;
+    object->marked = 0;
+    object->permanent = 0;
+    object->hashed = 0;
+    heap = object;
+    heap_objects++;
+    gc_charge(sizeof(GCObject) + size);
+    return object + 1;
+}
+
+char* gc_string(size_t length) {
+    char *chars = gc_alloc(GC_STRING, length + 1);
+    chars[length] = '\0';
+    return chars;
+}
+
+char* gc_strdup(const char *str) {
+    size_t length = strlen(str);
+    char *copy = gc_string(length);
+    memcpy(copy, str, length);
+    return copy;
+}
+
+char* gc_substring(const char *chars, size_t length) {
+    if (length <= 1) {
+        CharString *entry = &char_strings[length == 0 ? 256 : (unsigned char)chars[0]];
+        if (!entry->header.permanent) {
+            entry->header.size = length + 1;
+            entry->header.kind = GC_STRING;
+            entry->header.permanent = 1;
+            entry->chars[0] = length == 0 ? '\0' : chars[0];
+        }
+        return entry->chars;
+    }
+    char *copy = gc_string(length);
+    memcpy(copy, chars, length);
+    return copy;
+}
+
+static size_t gc_buffer_capacity(size_t size) {
+    size_t capacity = 32;
+    while (capacity < size) capacity *= 2;
+    return capacity;
+}
+
+char* gc_string_append(char *str, const char *chars, size_t length) {
+    GCObject *object = gc_header(str);
+    size_t size = object->size + length;
+
+    if (object->kind != GC_BUILDER || size > gc_buffer_capacity(object->size)) {
+        char *copy = gc_alloc(GC_BUILDER, gc_buffer_capacity(size));
+        memcpy(copy, str, object->size - 1);
+        gc_header(copy)->size = object->size;
+        object = gc_header(copy);
+    }
+
+    char *buffer = (char*)(object + 1);
+    memcpy(buffer + object->size - 1, chars, length);
+    buffer[size - 1] = '\0';
+    object->size = size;
+    object->hashed = 0;
+    return buffer;
+}
+
+List* gc_new_list(size_t capacity) {
+    if (capacity < 4) capacity = 4;
+    List *list = gc_alloc(GC_LIST, sizeof(List));
+    list->count = 0;
+    list->capacity = capacity;
+    list->items = tess_malloc(sizeof(Value) * capacity);
+    gc_charge(sizeof(Value) * capacity);
+    return list;
+}
+
+Dict* gc_new_dict(size_t count) {
+    Dict *dict = gc_alloc(GC_DICT, sizeof(Dict));
+    dict_init(dict, count);
+    gc_charge(dict_storage_bytes(dict));
+    return dict;
+}
+
+Object* gc_new_object(Shape *shape) {
+    size_t field_count = shape->fields.count;
+    Object *object = gc_alloc(GC_OBJECT, sizeof(Object) + sizeof(Value) * field_count);
+    object->shape = shape;
+    for (size_t i = 0; i < field_count; i++) {
+        object->fields[i] = value_null();
+    }
+    return object;
+}
+
+static void gc_mark_value(Value value) {
+    void *payload;
+    switch (value_type(value)) {
+        case VALUE_STRING: payload = value_as_string(value); break;
+        case VALUE_LIST: payload = value_as_list(value); break;
+        case VALUE_DICT: payload = value_as_dict(value); break;
+        case VALUE_OBJECT: payload = value_as_object(value); break;
+        default: return;
+    }
+    if (!payload) return;
+
+    GCObject *object = gc_header(payload);
+    if (object->marked || object->permanent) return;
+    object->marked = 1;
+    if (object->kind == GC_STRING || object->kind == GC_BUFFER || object->kind == GC_BUILDER) return;
+
+    if (gray_count >= gray_capacity) {
+        gray_capacity = gray_capacity == 0 ? 256 : gray_capacity * 2;
+        gray = realloc(gray, sizeof(GCObject*) * gray_capacity);
+    }
+    gray[gray_count++] = object;
+}
+
+static void gc_mark_values(Value *values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        gc_mark_value(values[i]);
+    }
+}
+
+static void gc_trace(GCObject *object) {
+    if (object->kind == GC_LIST) {
+        List *list = (List*)(object + 1);
+        gc_mark_values(list->items, list->count);
+        return;
+    }
+    if (object->kind == GC_OBJECT) {
+        Object *instance = (Object*)(object + 1);
+        gc_mark_values(instance->fields, instance->shape->fields.count);
+        return;
+    }
+
+    Dict *dict = (Dict*)(object + 1);
+    for (size_t i = 0; i < dict->count; i++) {
+        gc_mark_value(value_string(dict->entries[i].key));
+        gc_mark_value(dict->entries[i].value);
+    }
+}
+
+static void gc_mark_roots(Interpreter *interpreter) {
+    for (size_t i = 0; i < interpreter->global_count; i++) {
+        gc_mark_value(interpreter->globals[i].value);
+    }
+    gc_mark_values(interpreter->stack, interpreter->stack_top);
+    gc_mark_values(interpreter->temps, interpreter->temp_count);
+    gc_mark_value(interpreter->return_value);
+}
+
+static size_t gc_object_bytes(GCObject *object) {
+    if (object->kind == GC_BUFFER || object->kind == GC_BUILDER) {
+        return sizeof(GCObject) + gc_buffer_capacity(object->size);
+    }
+
+    size_t bytes = sizeof(GCObject) + object->size;
+    if (object->kind == GC_LIST) {
+        bytes += sizeof(Value) * ((List*)(object + 1))->capacity;
+    } else if (object->kind == GC_DICT) {
+        bytes += dict_storage_bytes((Dict*)(object + 1));
+    }
+    return bytes;
+}
+
+static void gc_free(GCObject *object) {
+    if (object->kind == GC_LIST) {
+        free(((List*)(object + 1))->items);
+    } else if (object->kind == GC_DICT) {
+        dict_release((Dict*)(object + 1));
+    }
+    free(object);
+}
+
+static void gc_sweep(void) {
+    heap_live = 0;
+    heap_objects = 0;
+    GCObject **link = &heap;
+    while (*link) {
+        GCObject *object = *link;
+        if (object->marked) {
+            object->marked = 0;
+            heap_live += gc_object_bytes(object);
+            heap_objects++;
+            link = &object->next;
+        } else {
+            *link = object->next;
+            gc_free(object);
+        }
+    }
+}
+
+void gc_collect(Interpreter *interpreter) {
+    clock_t start = clock();
+
+    gc_mark_roots(interpreter);
+    while (gray_count > 0) {
+        gc_trace(gray[--gray_count]);
+    }
+    gc_sweep();
+
+    heap_allocated = 0;
+    heap_threshold = (size_t)(heap_live * growth_factor);
+    if (heap_threshold < GC_MIN_HEAP) heap_threshold = GC_MIN_HEAP;
+    gc_pending = 0;
+
+    double pause = (double)(clock() - start) / CLOCKS_PER_SEC;
+    collections++;
+    pause_total += pause;
+    if (pause > pause_max) pause_max = pause;
+}
+
+void gc_release_all(void) {
+    while (heap) {
+        GCObject *next = heap->next;
+        gc_free(heap);
+        heap = next;
+    }
+    free(gray);
+    gray = NULL;
+    gray_capacity = 0;
+    heap_allocated = 0;
+    heap_live = 0;
+    heap_objects = 0;
+    heap_threshold = GC_MIN_HEAP;
+    gc_pending = 0;
+}
+
+void gc_set_growth_factor(double factor) {
+    growth_factor = factor;
+}
+
+void gc_get_stats(GCStats *stats) {
+    stats->collections = collections;
+    stats->pause_total = pause_total;
+    stats->pause_max = pause_max;
+    stats->live_bytes = heap_live;
+    stats->objects = heap_objects;
+    stats->heap_bytes = heap_live + heap_allocated;
+    stats->threshold = heap_threshold;
+}
@@ -1,4 +1,5 @@
 #include "http_client.h"
+#include "tess_alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,7 +16,7 @@ static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, voi
     size_t realsize = size * nmemb;
     struct MemoryStruct *mem = (struct MemoryStruct *)userp;
 
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
+    char *ptr = tess_realloc(mem->memory, mem->size + realsize + 1);
     if (!ptr) {
         printf("not enough memory (realloc returned NULL)\n");
         return 0;
@@ -34,7 +35,7 @@ static char* http_request_libcurl(const char *method, const char *url, const cha
     CURLcode res;
     struct MemoryStruct chunk;
 
-    chunk.memory = malloc(1);
+    chunk.memory = tess_malloc(1);
     chunk.size = 0;
 
     curl_global_init(CURL_GLOBAL_ALL);
@@ -42,7 +43,7 @@ static char* http_request_libcurl(const char *method, const char *url, const cha
     
     if (!curl_handle) {
         free(chunk.memory);
-        return strdup("HTTP Error: Failed to init curl");
+        return tess_strdup("HTTP Error: Failed to init curl");
     }
 
     curl_easy_setopt(curl_handle, CURLOPT_URL, url);
@@ -75,7 +76,7 @@ static char* http_request_libcurl(const char *method, const char *url, const cha
     res = curl_easy_perform(curl_handle);
 
     if (res != CURLE_OK) {
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: curl_easy_perform() failed: %s", curl_easy_strerror(res));
         free(chunk.memory);
         curl_slist_free_all(header_list);
@@ -152,7 +153,7 @@ static char* http_request_win32(const char *method, const char *url, const char
     
     hSession = WinHttpOpen(wUserAgent, WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, NULL, NULL, 0);
     if (!hSession) {
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to initialize WinHTTP");
         return error;
     }
@@ -160,7 +161,7 @@ static char* http_request_win32(const char *method, const char *url, const char
     hConnect = WinHttpConnect(hSession, wHostname, port, 0);
     if (!hConnect) {
         WinHttpCloseHandle(hSession);
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to connect to host");
         return error;
     }
@@ -170,7 +171,7 @@ static char* http_request_win32(const char *method, const char *url, const char
     if (!hRequest) {
         WinHttpCloseHandle(hConnect);
         WinHttpCloseHandle(hSession);
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to create request");
         return error;
     }
@@ -197,7 +198,7 @@ static char* http_request_win32(const char *method, const char *url, const char
         WinHttpCloseHandle(hRequest);
         WinHttpCloseHandle(hConnect);
         WinHttpCloseHandle(hSession);
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to send request");
         return error;
     }
@@ -206,7 +207,7 @@ static char* http_request_win32(const char *method, const char *url, const char
         WinHttpCloseHandle(hRequest);
         WinHttpCloseHandle(hConnect);
         WinHttpCloseHandle(hSession);
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to receive response");
         return error;
     }
@@ -216,12 +217,12 @@ static char* http_request_win32(const char *method, const char *url, const char
     
     size_t response_size = 0;
     size_t response_capacity = 4096;
-    response = malloc(response_capacity);
+    response = tess_malloc(response_capacity);
     if (!response) {
         WinHttpCloseHandle(hRequest);
         WinHttpCloseHandle(hConnect);
         WinHttpCloseHandle(hSession);
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Out of memory");
         return error;
     }
@@ -236,13 +237,13 @@ static char* http_request_win32(const char *method, const char *url, const char
         
         if (response_size + dwSize + 1 > response_capacity) {
             response_capacity = (response_size + dwSize) * 2;
-            char *new_response = realloc(response, response_capacity);
+            char *new_response = tess_realloc(response, response_capacity);
             if (!new_response) {
                 free(response);
                 WinHttpCloseHandle(hRequest);
                 WinHttpCloseHandle(hConnect);
                 WinHttpCloseHandle(hSession);
-                char *error = malloc(256);
+                char *error = tess_malloc(256);
                 snprintf(error, 256, "HTTP Error: Out of memory");
                 return error;
             }
@@ -310,21 +311,21 @@ static char* http_request_unix(const char *method, const char *url, const char *
     }
     
     if (is_https) {
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: HTTPS not supported in native implementation. Use http:// URLs or install libcurl for HTTPS support.");
         return error;
     }
     
     struct hostent *server = gethostbyname(hostname);
     if (!server) {
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to resolve hostname %s", hostname);
         return error;
     }
     
     sockfd = socket(AF_INET, SOCK_STREAM, 0);
     if (sockfd < 0) {
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to create socket");
         return error;
     }
@@ -337,7 +338,7 @@ static char* http_request_unix(const char *method, const char *url, const char *
     
     if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
         close(sockfd);
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to connect to %s:%d", hostname, port);
         return error;
     }
@@ -374,17 +375,17 @@ static char* http_request_unix(const char *method, const char *url, const char *
     
     if (send(sockfd, request, req_len, 0) < 0) {
         close(sockfd);
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Failed to send request");
         return error;
     }
     
     size_t response_size = 0;
     size_t response_capacity = 4096;
-    response = malloc(response_capacity);
+    response = tess_malloc(response_capacity);
     if (!response) {
         close(sockfd);
-        char *error = malloc(256);
+        char *error = tess_malloc(256);
         snprintf(error, 256, "HTTP Error: Out of memory");
         return error;
     }
@@ -411,11 +412,11 @@ static char* http_request_unix(const char *method, const char *url, const char *
                 if (body_len > 0) {
                     if (response_size + body_len + 1 > response_capacity) {
                         response_capacity = (response_size + body_len) * 2;
-                        char *new_response = realloc(response, response_capacity);
+                        char *new_response = tess_realloc(response, response_capacity);
                         if (!new_response) {
                             free(response);
                             close(sockfd);
-                            char *error = malloc(256);
+                            char *error = tess_malloc(256);
                             snprintf(error, 256, "HTTP Error: Out of memory");
                             return error;
                         }
@@ -428,11 +429,11 @@ static char* http_request_unix(const char *method, const char *url, const char *
         } else {
             if (response_size + n + 1 > response_capacity) {
                 response_capacity = (response_size + n) * 2;
-                char *new_response = realloc(response, response_capacity);
+                char *new_response = tess_realloc(response, response_capacity);
                 if (!new_response) {
                     free(response);
                     close(sockfd);
-                    char *error = malloc(256);
+                    char *error = tess_malloc(256);
                     snprintf(error, 256, "HTTP Error: Out of memory");
                     return error;
                 }
@@ -0,0 +1,27 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Bump allocator for everything a compilation produces: source text,
+ * token values, AST nodes and their strings. Nothing allocated from an
+ * arena is freed on its own; arena_destroy releases all of it at once,
+ * along with the string pool references taken through arena_intern.
+ */
+typedef struct ArenaChunk ArenaChunk;
+typedef struct ArenaString ArenaString;
+
+typedef struct Arena {
+    ArenaChunk *chunks;
+    ArenaString *interned;
+} Arena;
+
+Arena* arena_create(void);
+void arena_destroy(Arena *arena);
+void* arena_alloc(Arena *arena, size_t size);
+char* arena_strndup(Arena *arena, const char *chars, size_t length);
+char* arena_strdup(Arena *arena, const char *str);
+const char* arena_intern(Arena *arena, const char *chars, size_t length);
+
+#endif
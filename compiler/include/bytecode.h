@@ -0,0 +1,84 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdint.h>
+#include "interpreter.h"
+
+typedef enum {
+    OP_LOADK,       /* A B      R[A] = K[B] */
+    OP_LOADNULL,    /* A        R[A] = null */
+    OP_MOVE,        /* A B      R[A] = R[B] */
+    OP_GETGLOBAL,   /* A B      R[A] = G[B] */
+    OP_SETGLOBAL,   /* A B      G[B] = R[A] */
+    OP_ADD,         /* A B C    R[A] = R[B] + R[C] */
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_GT,
+    OP_LT,
+    OP_EQ,
+    OP_NEQ,
+    OP_LTE,
+    OP_GTE,
+    OP_APPEND,      /* A B C    R[A] = R[A] + R[B] + ... + R[B+C-1], in place */
+    OP_JMP,         /* target   pc = target */
+    OP_JMPIFNOT,    /* A target if !R[A] then pc = target */
+    OP_REPEAT,      /* A target if R[A] <= 0 then pc = target else R[A] -= 1 */
+    OP_CALL,        /* A B C    R[A] = R[A](R[A+1] .. R[A+B]), named K[C] */
+    OP_BUILTIN,     /* A B C    R[A] = BF[C](R[A+1] .. R[A+B]) */
+    OP_INVOKE,      /* A B C    R[A] = R[A].IC[C](R[A+1] .. R[A+B]) */
+    OP_GETMEMBER,   /* A B C    R[A] = R[B].IC[C] */
+    OP_INDEX,       /* A B C    R[A] = R[B][R[C]] */
+    OP_NEWLIST,     /* A B C    R[A] = [R[B] .. R[B+C-1]] */
+    OP_NEWDICT,     /* A        R[A] = {} */
+    OP_NEW,         /* A B      R[A] = new R[B]() */
+    OP_PRINT,       /* A B      print R[A] .. R[A+B-1] */
+    OP_HTTP,        /* A B C    R[A] = request R[B] R[B+1] (R[B+2] if C) */
+    OP_START,       /* A B      R[A] = entry point G[B]() */
+    OP_IMPORT,      /* B        add K[B] */
+    OP_TRY,         /* target   install a catch handler at target */
+    OP_ENDTRY,      /*          remove the innermost catch handler */
+    OP_CATCH,       /* A        R[A] = pending error, clearing it */
+    OP_RETURN       /* A        return R[A] */
+} OpCode;
+
+typedef struct {
+    uint16_t op;
+    uint16_t a;
+    union {
+        struct {
+            uint16_t b;
+            uint16_t c;
+        };
+        uint32_t target;
+    };
+} Instruction;
+
+typedef struct Proto {
+    char *name;
+    Instruction *code;
+    size_t code_count;
+    size_t code_capacity;
+    Value *constants;
+    size_t constant_count;
+    size_t constant_capacity;
+    struct Proto **protos;
+    size_t proto_count;
+    size_t proto_capacity;
+    BuiltinFunc *builtins;
+    size_t builtin_count;
+    size_t builtin_capacity;
+    struct InlineCache **caches;
+    size_t cache_count;
+    size_t cache_capacity;
+    int param_count;
+    int register_count;
+    int handler_count;
+} Proto;
+
+Proto* bytecode_compile(ASTNode *program);
+Proto* bytecode_compile_function(ASTNode *func_node);
+void bytecode_destroy(Proto *proto);
+
+#endif
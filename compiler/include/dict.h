@@ -0,0 +1,22 @@
+#ifndef DICT_H
+#define DICT_H
+
+#include "interpreter.h"
+
+/*
+ * The table behind dicts, objects and the builtin namespaces. Entries sit
+ * in a dense array in insertion order, which is also iteration order.
+ * They are found through an open-addressing index probed sixteen control
+ * bytes at a time, SwissTable style: a control byte is DICT_EMPTY or the
+ * low seven bits of a key's hash, so most misses are rejected without
+ * touching an entry. The index doubles once it is 7/8 full.
+ *
+ * Keys are strings with a GC header and are stored without copying.
+ */
+void dict_init(Dict *dict, size_t count);
+void dict_release(Dict *dict);
+size_t dict_storage_bytes(const Dict *dict);
+Value* dict_find(Dict *dict, const char *key);
+void dict_set(Dict *dict, char *key, Value value);
+
+#endif
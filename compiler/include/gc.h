@@ -0,0 +1,75 @@
+#ifndef GC_H
+#define GC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "interpreter.h"
+
+/*
+ * Mark-sweep collector for the strings, lists, dicts and objects a script
+ * creates. Every collectable allocation is preceded by a GCObject header,
+ * and so is every pooled string constant, which is marked permanent.
+ *
+ * Allocation never collects. It only sets gc_pending once the heap has
+ * grown past its threshold; the interpreter and VM call gc_collect at safe
+ * points where every live value is reachable from the interpreter's roots.
+ * After a collection the threshold becomes the live size times the growth
+ * factor.
+ *
+ * Strings built by appending live in power-of-two buffers. A GC_BUILDER is
+ * a buffer that still has exactly one owner and may be extended in place;
+ * once it is finished it becomes a GC_BUFFER and is as immutable as any
+ * other string.
+ */
+typedef enum {
+    GC_STRING,
+    GC_BUFFER,
+    GC_BUILDER,
+    GC_LIST,
+    GC_DICT,
+    GC_OBJECT
+} GCKind;
+
+typedef struct GCObject {
+    struct GCObject *next;
+    size_t size;
+    unsigned char kind;
+    unsigned char marked;
+    unsigned char permanent;
+    unsigned char hashed;
+    uint32_t hash;
+} GCObject;
+
+typedef struct {
+    size_t collections;
+    double pause_total;
+    double pause_max;
+    size_t live_bytes;
+    size_t objects;
+    size_t heap_bytes;
+    size_t threshold;
+} GCStats;
+
+extern int gc_pending;
+
+static inline GCObject* gc_header(const void *payload) {
+    return (GCObject*)payload - 1;
+}
+
+char* gc_string(size_t length);
+char* gc_strdup(const char *str);
+char* gc_string_append(char *str, const char *chars, size_t length);
+
+/* Copies length bytes into a new string. Empty and one-byte results come
+ * from a permanent table instead, so they allocate nothing. */
+char* gc_substring(const char *chars, size_t length);
+List* gc_new_list(size_t capacity);
+Dict* gc_new_dict(size_t count);
+Object* gc_new_object(Shape *shape);
+
+void gc_collect(Interpreter *interpreter);
+void gc_release_all(void);
+void gc_set_growth_factor(double factor);
+void gc_get_stats(GCStats *stats);
+
+#endif
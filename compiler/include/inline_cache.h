@@ -0,0 +1,46 @@
+#ifndef INLINE_CACHE_H
+#define INLINE_CACHE_H
+
+#include <stdio.h>
+#include "interpreter.h"
+
+/*
+ * Each member-access site remembers where it found its member for up to
+ * INLINE_CACHE_WAYS object shapes. A hit compares shape pointers and reads
+ * the field slot or shared method directly, without hashing the name. A
+ * site that meets more shapes than that is megamorphic: it keeps answering
+ * from the shapes it holds and does a full shape lookup for the rest.
+ *
+ * A site's cache hangs off its AST_MEMBER_ACCESS node and is shared by
+ * both engines; the VM reaches it through its proto's cache table. It also
+ * holds the file method and builtin the member name binds to, so calls
+ * through files and builtin namespaces do not look the name up either.
+ *
+ * inline_cache_release_all frees every cache and clears the node's
+ * pointer to it, so the trees must still be alive when it runs.
+ */
+#define INLINE_CACHE_WAYS 4
+
+typedef struct InlineCache {
+    const char *name;
+    int line;
+    int column;
+    int count;
+    int megamorphic;
+    Shape *shapes[INLINE_CACHE_WAYS];
+    int slots[INLINE_CACHE_WAYS];
+    Value methods[INLINE_CACHE_WAYS];
+    size_t hits;
+    size_t misses;
+    BuiltinFunc file_method;
+    BuiltinFunc builtin;
+    ASTNode *node;
+    struct InlineCache *next;
+} InlineCache;
+
+InlineCache* inline_cache_for(ASTNode *node);
+int inline_cache_find(InlineCache *cache, Value object, Value *out);
+void inline_cache_report(FILE *out);
+void inline_cache_release_all(void);
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include "parser.h"
 
 typedef enum {
@@ -19,6 +22,77 @@ typedef enum {
 typedef struct Value Value;
 typedef struct List List;
 typedef struct Dict Dict;
+typedef struct Object Object;
+typedef struct Shape Shape;
+typedef struct ModuleRegistry ModuleRegistry;
+
+#ifdef TESS_NAN_BOXING
+
+/*
+ * A Value is 8 bytes. Numbers are stored as their own bits. Every other
+ * value is a negative NaN with its ValueType in bits 48-51 and a pointer
+ * or small payload in the low 48 bits, so pointers must fit in 48 bits.
+ * value_number folds any NaN that would collide with that range into the
+ * positive quiet NaN.
+ */
+struct Value {
+    uint64_t bits;
+};
+
+_Static_assert(sizeof(void*) == 8, "TESS_NAN_BOXING needs 64-bit pointers");
+
+#define VALUE_BOX_BASE 0xFFF0000000000000ULL
+#define VALUE_BOX_MIN 0xFFF1000000000000ULL
+#define VALUE_BOX_PAYLOAD 0x0000FFFFFFFFFFFFULL
+#define VALUE_CANONICAL_NAN 0x7FF8000000000000ULL
+
+static inline Value value_box(ValueType type, uint64_t payload) {
+    Value value;
+    value.bits = VALUE_BOX_BASE | ((uint64_t)type << 48) | (payload & VALUE_BOX_PAYLOAD);
+    return value;
+}
+
+static inline void* value_pointer(Value value) {
+    return (void*)(uintptr_t)(value.bits & VALUE_BOX_PAYLOAD);
+}
+
+static inline ValueType value_type(Value value) {
+    return value.bits < VALUE_BOX_MIN ? VALUE_NUMBER : (ValueType)((value.bits >> 48) & 0xF);
+}
+
+static inline Value value_number(double number) {
+    Value value;
+    memcpy(&value.bits, &number, sizeof(number));
+    if (value.bits >= VALUE_BOX_MIN) value.bits = VALUE_CANONICAL_NAN;
+    return value;
+}
+
+static inline double value_as_number(Value value) {
+    double number;
+    memcpy(&number, &value.bits, sizeof(number));
+    return number;
+}
+
+static inline Value value_null(void) { return value_box(VALUE_NULL, 0); }
+static inline Value value_boolean(int boolean) { return value_box(VALUE_BOOLEAN, boolean != 0); }
+static inline Value value_string(const char *string) { return value_box(VALUE_STRING, (uintptr_t)string); }
+static inline Value value_list(List *list) { return value_box(VALUE_LIST, (uintptr_t)list); }
+static inline Value value_dict(Dict *dict) { return value_box(VALUE_DICT, (uintptr_t)dict); }
+static inline Value value_object(Object *object) { return value_box(VALUE_OBJECT, (uintptr_t)object); }
+static inline Value value_file(FILE *file) { return value_box(VALUE_FILE, (uintptr_t)file); }
+static inline Value value_function(ASTNode *function) { return value_box(VALUE_FUNCTION, (uintptr_t)function); }
+static inline Value value_class(ASTNode *class_def) { return value_box(VALUE_CLASS, (uintptr_t)class_def); }
+
+static inline int value_as_boolean(Value value) { return (int)(value.bits & 1); }
+static inline char* value_as_string(Value value) { return value_pointer(value); }
+static inline List* value_as_list(Value value) { return value_pointer(value); }
+static inline Dict* value_as_dict(Value value) { return value_pointer(value); }
+static inline Object* value_as_object(Value value) { return value_pointer(value); }
+static inline FILE* value_as_file(Value value) { return value_pointer(value); }
+static inline ASTNode* value_as_function(Value value) { return value_pointer(value); }
+static inline ASTNode* value_as_class(Value value) { return value_pointer(value); }
+
+#else
 
 struct Value {
     ValueType type;
@@ -28,59 +102,188 @@ struct Value {
         int boolean;
         List *list;
         Dict *dict;
+        Object *object;
         FILE *file;
         ASTNode *function;
         ASTNode *class_def;
     } as;
 };
 
+static inline ValueType value_type(Value value) { return value.type; }
+
+static inline Value value_null(void) { Value v; v.type = VALUE_NULL; v.as.number = 0; return v; }
+static inline Value value_number(double number) { Value v; v.type = VALUE_NUMBER; v.as.number = number; return v; }
+static inline Value value_boolean(int boolean) { Value v; v.type = VALUE_BOOLEAN; v.as.boolean = boolean != 0; return v; }
+static inline Value value_string(const char *string) { Value v; v.type = VALUE_STRING; v.as.string = (char*)string; return v; }
+static inline Value value_list(List *list) { Value v; v.type = VALUE_LIST; v.as.list = list; return v; }
+static inline Value value_dict(Dict *dict) { Value v; v.type = VALUE_DICT; v.as.dict = dict; return v; }
+static inline Value value_object(Object *object) { Value v; v.type = VALUE_OBJECT; v.as.object = object; return v; }
+static inline Value value_file(FILE *file) { Value v; v.type = VALUE_FILE; v.as.file = file; return v; }
+static inline Value value_function(ASTNode *function) { Value v; v.type = VALUE_FUNCTION; v.as.function = function; return v; }
+static inline Value value_class(ASTNode *class_def) { Value v; v.type = VALUE_CLASS; v.as.class_def = class_def; return v; }
+
+static inline double value_as_number(Value value) { return value.as.number; }
+static inline int value_as_boolean(Value value) { return value.as.boolean; }
+static inline char* value_as_string(Value value) { return value.as.string; }
+static inline List* value_as_list(Value value) { return value.as.list; }
+static inline Dict* value_as_dict(Value value) { return value.as.dict; }
+static inline Object* value_as_object(Value value) { return value.as.object; }
+static inline FILE* value_as_file(Value value) { return value.as.file; }
+static inline ASTNode* value_as_function(Value value) { return value.as.function; }
+static inline ASTNode* value_as_class(Value value) { return value.as.class_def; }
+
+#endif
+
 struct List {
     Value *items;
     size_t count;
     size_t capacity;
 };
 
-typedef struct DictEntry {
+/* An instance: its shape, then one slot per field the shape declares. */
+struct Object {
+    Shape *shape;
+    Value fields[];
+};
+
+typedef struct {
     char *key;
-    Value *value;
-    struct DictEntry *next;
+    Value value;
 } DictEntry;
 
 struct Dict {
-    DictEntry **buckets;
-    size_t bucket_count;
+    DictEntry *entries;
     size_t count;
+    size_t entry_capacity;
+    unsigned char *ctrl;
+    uint32_t *slots;
+    size_t capacity;
 };
 
+/* A block or function's locals: a run of slots on the value stack. */
+typedef struct {
+    Value *slots;
+    size_t count;
+} Scope;
+
 typedef struct {
     char *name;
     Value value;
-} Variable;
+    int defined;
+} Global;
+
+/*
+ * Call arguments, AST-walker locals and VM registers share one value stack
+ * of INTERPRETER_STACK_SIZE slots, allocated once. A caller leaves its
+ * arguments on top and the callee's frame starts at the first of them, so
+ * a call moves stack_top instead of copying or allocating. The collector
+ * treats everything below stack_top as live.
+ */
+#ifndef INTERPRETER_STACK_SIZE
+#define INTERPRETER_STACK_SIZE (1024 * 1024)
+#endif
+
+/* Default for how deeply script calls may nest before a call fails with a
+ * catchable stack overflow error. The AST walker recurses on the C stack
+ * for every call, so it also fails a call once it has used three quarters
+ * of that stack, however many calls that took. */
+#ifndef INTERPRETER_MAX_DEPTH
+#define INTERPRETER_MAX_DEPTH 10000
+#endif
 
+struct Proto;
+
+/* A VM call in progress. The running frame's pc and handler count are
+ * kept in vm_run's locals and saved here when it calls another function. */
 typedef struct {
-    Variable *variables;
-    size_t count;
-    size_t capacity;
-} Scope;
+    struct Proto *proto;
+    Value *regs;
+    size_t pc;
+    size_t handler_base;
+    int handler_count;
+    int result;
+    size_t top;
+} CallFrame;
+
+typedef enum {
+    ENGINE_VM,
+    ENGINE_AST
+} Engine;
+
+typedef enum {
+    COMPLETION_NORMAL,
+    COMPLETION_RETURN,
+    COMPLETION_BREAK,
+    COMPLETION_CONTINUE
+} Completion;
 
 typedef struct {
     Scope *scopes;
     size_t scope_count;
     size_t scope_capacity;
+    Global *globals;
+    size_t global_count;
+    size_t global_capacity;
+    int *global_index;
+    size_t global_index_capacity;
+    ModuleRegistry *modules;
+    Value *stack;
+    size_t stack_top;
+    size_t *handlers;
+    size_t handler_top;
+    size_t handler_capacity;
+    CallFrame *frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    size_t call_depth;
+    size_t max_depth;
+    uintptr_t c_stack_base;
+    size_t c_stack_budget;
+    Value *temps;
+    size_t temp_count;
+    size_t temp_capacity;
+    Engine engine;
     int in_loop;
-    int break_loop;
-    int continue_loop;
+    Completion completion;
+    Value return_value;
     int error_occurred;
     char error_message[256];
 } Interpreter;
 
 Interpreter* interpreter_create(void);
 void interpreter_destroy(Interpreter *interpreter);
-void interpreter_push_scope(Interpreter *interpreter);
+int interpreter_push_scope(Interpreter *interpreter, size_t slot_count);
+int interpreter_push_frame(Interpreter *interpreter, ASTNode *func_node, int argc);
 void interpreter_pop_scope(Interpreter *interpreter);
+int interpreter_stack_overflow(Interpreter *interpreter);
+void interpreter_set_max_depth(size_t depth);
+int interpreter_find_global(Interpreter *interpreter, const char *name);
+int interpreter_global_slot(Interpreter *interpreter, const char *name);
 void interpreter_set_variable(Interpreter *interpreter, const char *name, Value value);
 Value interpreter_get_variable(Interpreter *interpreter, const char *name);
 Value interpreter_eval(Interpreter *interpreter, ASTNode *node);
 Value interpreter_call_function(Interpreter *interpreter, ASTNode *node);
 
+typedef Value (*BuiltinFunc)(Value *args, int argc);
+
+static inline int interpreter_is_truthy(Value value) {
+    ValueType type = value_type(value);
+    if (type == VALUE_NUMBER) return value_as_number(value) != 0;
+    if (type == VALUE_NULL) return 0;
+    if (type == VALUE_BOOLEAN) return value_as_boolean(value);
+    return 1;
+}
+
+void interpreter_print_value(Value value);
+Value interpreter_concat(Value left, Value right);
+Value interpreter_append(Value target, Value *parts, int count);
+Value interpreter_binary_op(BinaryOperator op, Value left, Value right);
+Value interpreter_index(Interpreter *interpreter, Value collection, Value index);
+Value interpreter_new_object(Value class_val);
+int interpreter_find_member(Value object, const char *name, Value *out);
+BuiltinFunc interpreter_file_method(const char *name);
+Value interpreter_http_request(Value method_val, Value url_val, Value *data_val);
+Value interpreter_take_error(Interpreter *interpreter);
+void interpreter_import(Interpreter *interpreter, const char *module_name);
+
 #endif
@@ -2,6 +2,8 @@
 #define LEXER_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
 
 typedef enum {
     TOKEN_EOF,
@@ -53,14 +55,22 @@ typedef enum {
     TOKEN_CATCH
 } TessTokenType;
 
+/*
+ * A token is a span of the lexer's source. Only string literals that
+ * contain escapes carry decoded text, allocated from the arena; for those
+ * length is the length of text.
+ */
 typedef struct {
     TessTokenType type;
-    char *value;
+    uint32_t start;
+    uint32_t length;
+    const char *text;
     int line;
     int column;
 } Token;
 
 typedef struct {
+    Arena *arena;
     const char *source;
     size_t source_len;
     size_t position;
@@ -71,7 +81,10 @@ typedef struct {
     size_t token_capacity;
 } Lexer;
 
-Lexer* lexer_create(const char *source);
+/* source is borrowed and must stay valid until parsing is done. It need
+ * not be NUL-terminated. */
+Lexer* lexer_create(const char *source, size_t length, Arena *arena);
+const char* lexer_token_chars(Lexer *lexer, Token token);
 void lexer_destroy(Lexer *lexer);
 void lexer_tokenize(Lexer *lexer);
 
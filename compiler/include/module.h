@@ -3,7 +3,16 @@
 
 #include "interpreter.h"
 
-ASTNode* module_load(const char *module_name);
-void module_execute(Interpreter *interpreter, ASTNode *module_ast);
+ModuleRegistry* module_registry_create(void);
+void module_registry_destroy(ModuleRegistry *registry);
+
+/* Resolves module_name and runs the module the first time its file is
+ * imported into the interpreter. Later imports, under any name that
+ * resolves to the same file, are a single lookup. */
+void module_import(Interpreter *interpreter, const char *module_name);
+
+/* Reports each module's resolved path and resolve and parse times on
+ * stderr the first time it is imported. */
+void module_set_trace(int enabled);
 
 #endif
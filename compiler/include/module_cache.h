@@ -0,0 +1,24 @@
+#ifndef MODULE_CACHE_H
+#define MODULE_CACHE_H
+
+#include "parser.h"
+
+/*
+ * Imported modules are cached beside their source as <file>.tessc. A
+ * cache file is used only when it was written by the same cache format
+ * for source with the same length and either the same modification time
+ * or the same content hash, and its body matches the checksum in its
+ * header; anything else is a miss and the source is parsed again.
+ */
+
+/* Parses the module at path into arena, from the cache when it is valid.
+ * A fresh parse rewrites the cache. Returns NULL if the file cannot be
+ * opened. */
+ASTNode* module_cache_parse(const char *path, Arena *arena);
+
+/* Parses the file at path without reading or writing a cache, for the
+ * script a program starts from. */
+ASTNode* module_parse_file(const char *path, Arena *arena);
+void module_cache_set_enabled(int enabled);
+
+#endif
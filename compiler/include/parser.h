@@ -36,6 +36,25 @@ typedef enum {
     AST_START
 } ASTNodeType;
 
+typedef enum {
+    BINOP_ADD,
+    BINOP_SUB,
+    BINOP_MUL,
+    BINOP_DIV,
+    BINOP_MOD,
+    BINOP_GT,
+    BINOP_LT,
+    BINOP_EQ,
+    BINOP_NEQ,
+    BINOP_GTE,
+    BINOP_LTE
+} BinaryOperator;
+
+struct Proto;
+struct Shape;
+struct InlineCache;
+struct Value;
+
 typedef struct ASTNode {
     ASTNodeType type;
     struct ASTNode *left;
@@ -43,12 +62,24 @@ typedef struct ASTNode {
     struct ASTNode *children;
     struct ASTNode *next;
     char *value;
+    double number;
+    BinaryOperator op;
+    int call;
     int line;
     int column;
+    int depth;
+    int slot;
+    int local_count;
+    int appends;
+    struct Proto *proto;
+    struct Shape *shape;
+    struct InlineCache *cache;
+    struct Value (*builtin)(struct Value *args, int argc);
 } ASTNode;
 
 typedef struct {
     Lexer *lexer;
+    Arena *arena;
     Token *tokens;
     size_t token_count;
     size_t token_index;
@@ -57,8 +88,8 @@ typedef struct {
 Parser* parser_create(Lexer *lexer);
 void parser_destroy(Parser *parser);
 ASTNode* parser_parse(Parser *parser);
-ASTNode* ast_create_node(ASTNodeType type);
-void ast_destroy_node(ASTNode *node);
-void ast_destroy_tree(ASTNode *root);
+/* Nodes and their strings live in the lexer's arena and are released
+ * with it; there is no per-node teardown. */
+ASTNode* ast_create_node(Arena *arena, ASTNodeType type);
 
 #endif
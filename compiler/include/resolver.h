@@ -0,0 +1,21 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "interpreter.h"
+
+/*
+ * Binds every name in the tree before it runs. Locals get node->depth
+ * (scopes to walk out from the innermost one) and node->slot; globals get
+ * depth -1 and a slot in interpreter->globals. Blocks, catch clauses and
+ * functions record how many slots their scope needs in node->local_count.
+ * An assignment of the form x = x + a + b to a local, where no operand
+ * reads x, records its operand count in node->appends so both engines can
+ * append to x in place.
+ *
+ * Calls and member calls whose name is a builtin get node->builtin, so
+ * neither engine looks a builtin up by name while running. A builtin
+ * still wins over a script function of the same name.
+ */
+void resolver_resolve(Interpreter *interpreter, ASTNode *program);
+
+#endif
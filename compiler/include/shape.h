@@ -0,0 +1,29 @@
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include "interpreter.h"
+
+/*
+ * The layout objects share. A shape maps each field name to a slot in the
+ * object's inline field array and each method name to the one function
+ * every instance uses, so an object is a single allocation: a shape
+ * pointer followed by its fields. Fields must all be added before the
+ * first object of a shape is created.
+ *
+ * A class's shape is built on its first new and cached on the class node.
+ * Shapes live as long as the program, like compiled protos, and their
+ * names are interned in the string pool.
+ */
+struct Shape {
+    Dict fields;
+    Dict methods;
+};
+
+Shape* shape_create(void);
+int shape_add_field(Shape *shape, const char *name);
+void shape_add_method(Shape *shape, const char *name, Value method);
+Shape* shape_for_class(ASTNode *class_def);
+int shape_lookup(Shape *shape, const char *name, int *slot, Value *method);
+int shape_find(const Object *object, const char *name, Value *out);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A source file mapped read-only into memory. The text is not
+ * NUL-terminated; the lexer reads it in place using length. mtime is the
+ * last modification time in seconds since the epoch.
+ */
+typedef struct {
+    const char *data;
+    size_t length;
+    int64_t mtime;
+    int mapped;
+} SourceFile;
+
+int source_open(SourceFile *source, const char *path);
+void source_close(SourceFile *source);
+
+#endif
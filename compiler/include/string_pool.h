@@ -0,0 +1,16 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Process-wide pool of immutable string constants. Interning returns the
+ * shared copy with one more reference; the text stays valid until the last
+ * reference is released. Pooled strings must never be written to or freed
+ * directly, so a literal can be handed out as a Value with no allocation.
+ */
+const char* string_pool_intern(const char *chars, size_t length);
+const char* string_pool_retain(const char *str);
+void string_pool_release(const char *str);
+
+#endif
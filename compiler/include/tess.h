@@ -16,5 +16,11 @@ int tess_lint(const char *file);
 int tess_check(const char *file);
 int tess_venv(const char *dir);
 int tess_test(void);
+int tess_set_engine(const char *name);
+void tess_set_cache(int enabled);
+void tess_set_trace_imports(int enabled);
+void tess_set_ic_stats(int enabled);
+int tess_set_gc_growth(const char *factor);
+int tess_set_max_depth(const char *depth);
 
 #endif
@@ -0,0 +1,20 @@
+#ifndef TESS_ALLOC_H
+#define TESS_ALLOC_H
+
+#include <stddef.h>
+
+/*
+ * Counting wrappers used by the runtime for everything a script can cause
+ * to be allocated. The totals are cumulative bytes requested and calls
+ * made; they never go down, so the difference across a request is what
+ * that request allocated.
+ */
+void* tess_malloc(size_t size);
+void* tess_calloc(size_t count, size_t size);
+void* tess_realloc(void *ptr, size_t size);
+char* tess_strdup(const char *str);
+
+size_t tess_alloc_bytes(void);
+size_t tess_alloc_count(void);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef TESS_STRING_H
+#define TESS_STRING_H
+
+#include <stdint.h>
+#include "gc.h"
+
+/*
+ * A string Value always points at text preceded by a GCObject header,
+ * whether the text came from the collector or the constant pool, so its
+ * length is the header size and its hash is computed at most once.
+ * Strings are never written after they are created, so every copy of a
+ * Value shares the same text and none of them needs a reference count.
+ * The one exception is a GC_BUILDER held by a single local, which
+ * gc_string_append extends in place; the engines call string_finish
+ * wherever a string Value is copied, so a builder never has two owners.
+ */
+static inline size_t string_length(const char *str) {
+    return gc_header(str)->size - 1;
+}
+
+static inline uint32_t string_hash_chars(const char *chars) {
+    uint32_t hash = 5381;
+    unsigned char c;
+    while ((c = (unsigned char)*chars++)) hash = ((hash << 5) + hash) + c;
+    return hash;
+}
+
+static inline uint32_t string_hash(const char *str) {
+    GCObject *header = gc_header(str);
+    if (!header->hashed) {
+        header->hash = string_hash_chars(str);
+        header->hashed = 1;
+    }
+    return header->hash;
+}
+
+static inline void string_finish(Value value) {
+    if (value_type(value) != VALUE_STRING || !value_as_string(value)) return;
+    GCObject *header = gc_header(value_as_string(value));
+    if (header->kind == GC_BUILDER) header->kind = GC_BUFFER;
+}
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef VM_H
+#define VM_H
+
+#include "bytecode.h"
+
+Value vm_execute(Interpreter *interpreter, Proto *proto);
+Value vm_call_function(Interpreter *interpreter, ASTNode *func_node, Value *args, int argc);
+
+#endif
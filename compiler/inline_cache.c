@@ -0,0 +1,74 @@
+#include <stdlib.h>
+#include "inline_cache.h"
+#include "shape.h"
+
+static InlineCache *sites = NULL;
+static InlineCache **sites_tail = &sites;
+
+InlineCache* inline_cache_for(ASTNode *node) {
+    if (!node->cache) {
+        InlineCache *cache = calloc(1, sizeof(InlineCache));
+        cache->name = node->right && node->right->value ? node->right->value : "";
+        cache->line = node->line;
+        cache->column = node->column;
+        cache->file_method = interpreter_file_method(cache->name);
+        cache->builtin = node->builtin;
+        cache->node = node;
+        *sites_tail = cache;
+        sites_tail = &cache->next;
+        node->cache = cache;
+    }
+    return node->cache;
+}
+
+int inline_cache_find(InlineCache *cache, Value object, Value *out) {
+    if (value_type(object) != VALUE_OBJECT) return 0;
+    Object *instance = value_as_object(object);
+    Shape *shape = instance->shape;
+
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->shapes[i] == shape) {
+            cache->hits++;
+            *out = cache->slots[i] >= 0 ? instance->fields[cache->slots[i]] : cache->methods[i];
+            return 1;
+        }
+    }
+
+    cache->misses++;
+    int slot;
+    Value method;
+    if (!shape_lookup(shape, cache->name, &slot, &method)) return 0;
+    if (cache->count < INLINE_CACHE_WAYS) {
+        cache->shapes[cache->count] = shape;
+        cache->slots[cache->count] = slot;
+        cache->methods[cache->count] = method;
+        cache->count++;
+    } else {
+        cache->megamorphic = 1;
+    }
+    *out = slot >= 0 ? instance->fields[slot] : method;
+    return 1;
+}
+
+void inline_cache_report(FILE *out) {
+    for (InlineCache *cache = sites; cache; cache = cache->next) {
+        size_t total = cache->hits + cache->misses;
+        if (total == 0) continue;
+        const char *state = cache->megamorphic ? "megamorphic"
+                          : cache->count > 1 ? "polymorphic"
+                          : cache->count == 1 ? "monomorphic" : "unresolved";
+        fprintf(out, "[ic] %d:%d .%s: %zu hits, %zu misses (%.1f%% hit), %s\n",
+                cache->line, cache->column, cache->name, cache->hits, cache->misses,
+                100.0 * (double)cache->hits / (double)total, state);
+    }
+}
+
+void inline_cache_release_all(void) {
+    while (sites) {
+        InlineCache *next = sites->next;
+        sites->node->cache = NULL;
+        free(sites);
+        sites = next;
+    }
+    sites_tail = &sites;
+}
@@ -3,26 +3,75 @@
 #include <string.h>
 #include <math.h>
 #include <ctype.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 #include "interpreter.h"
 #include "module.h"
 #include "tess_stdlib.h"
 #include "builtins.h"
 #include "http_client.h"
+#include "tess_alloc.h"
+#include "tess_string.h"
+#include "dict.h"
+#include "shape.h"
+#include "inline_cache.h"
 
 static char *error_message = NULL;
+static size_t max_depth = INTERPRETER_MAX_DEPTH;
+
+void interpreter_set_max_depth(size_t depth) {
+    max_depth = depth;
+}
+
+/* Bytes of C stack the AST walker may use, leaving a quarter of the
+ * stack for builtins and whatever nests between two calls. */
+static size_t interpreter_c_stack_budget(void) {
+    size_t size = 8 * 1024 * 1024;
+#ifdef _WIN32
+    size = 1024 * 1024;
+#else
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        size = (size_t)limit.rlim_cur;
+    }
+#endif
+    return size - size / 4;
+}
 
 Interpreter* interpreter_create(void) {
-    Interpreter *interpreter = malloc(sizeof(Interpreter));
+    Interpreter *interpreter = tess_malloc(sizeof(Interpreter));
     interpreter->scopes = NULL;
     interpreter->scope_count = 0;
     interpreter->scope_capacity = 0;
+    interpreter->globals = NULL;
+    interpreter->global_count = 0;
+    interpreter->global_capacity = 0;
+    interpreter->global_index = NULL;
+    interpreter->global_index_capacity = 0;
+    interpreter->modules = module_registry_create();
+    interpreter->stack = tess_malloc(sizeof(Value) * INTERPRETER_STACK_SIZE);
+    interpreter->stack_top = 0;
+    interpreter->handlers = NULL;
+    interpreter->handler_top = 0;
+    interpreter->handler_capacity = 0;
+    interpreter->frames = NULL;
+    interpreter->frame_count = 0;
+    interpreter->frame_capacity = 0;
+    interpreter->call_depth = 0;
+    interpreter->max_depth = max_depth;
+    interpreter->c_stack_base = (uintptr_t)&interpreter;
+    interpreter->c_stack_budget = interpreter_c_stack_budget();
+    interpreter->temps = NULL;
+    interpreter->temp_count = 0;
+    interpreter->temp_capacity = 0;
     interpreter->in_loop = 0;
-    interpreter->break_loop = 0;
-    interpreter->continue_loop = 0;
+    interpreter->completion = COMPLETION_NORMAL;
+    interpreter->return_value = value_null();
     interpreter->error_occurred = 0;
+    interpreter->engine = ENGINE_VM;
     memset(interpreter->error_message, 0, sizeof(interpreter->error_message));
     
-    interpreter_push_scope(interpreter);
     register_builtins(interpreter);
     
     return interpreter;
@@ -30,101 +79,501 @@ Interpreter* interpreter_create(void) {
 
 void interpreter_destroy(Interpreter *interpreter) {
     if (interpreter) {
-        if (interpreter->scopes) {
-            for (size_t i = 0; i < interpreter->scope_count; i++) {
-                for (size_t j = 0; j < interpreter->scopes[i].count; j++) {
-                    free(interpreter->scopes[i].variables[j].name);
-                }
-                if (interpreter->scopes[i].variables) {
-                    free(interpreter->scopes[i].variables);
-                }
-            }
-            free(interpreter->scopes);
+        while (interpreter->scope_count > 0) {
+            interpreter_pop_scope(interpreter);
         }
+        free(interpreter->scopes);
+        for (size_t i = 0; i < interpreter->global_count; i++) {
+            free(interpreter->globals[i].name);
+        }
+        free(interpreter->globals);
+        free(interpreter->global_index);
+        free(interpreter->temps);
+        free(interpreter->stack);
+        free(interpreter->handlers);
+        free(interpreter->frames);
+        free(error_message);
+        error_message = NULL;
+        inline_cache_release_all();
+        module_registry_destroy(interpreter->modules);
+        gc_release_all();
         free(interpreter);
     }
 }
 
-void interpreter_push_scope(Interpreter *interpreter) {
+/* Fails the call being made with an error a try block can catch. */
+int interpreter_stack_overflow(Interpreter *interpreter) {
+    if (!interpreter->error_occurred) {
+        printf("Error: Stack overflow\n");
+        fflush(stdout);
+        free(error_message);
+        error_message = tess_strdup("Stack overflow");
+    }
+    interpreter->error_occurred = 1;
+    return 0;
+}
+
+int interpreter_push_scope(Interpreter *interpreter, size_t slot_count) {
+    if (slot_count > INTERPRETER_STACK_SIZE - interpreter->stack_top) {
+        return interpreter_stack_overflow(interpreter);
+    }
     if (interpreter->scope_count >= interpreter->scope_capacity) {
         size_t new_capacity = interpreter->scope_capacity == 0 ? 4 : interpreter->scope_capacity * 2;
-        interpreter->scopes = realloc(interpreter->scopes, 
+        interpreter->scopes = tess_realloc(interpreter->scopes, 
                                     sizeof(Scope) * new_capacity);
         interpreter->scope_capacity = new_capacity;
     }
     
     Scope *scope = &interpreter->scopes[interpreter->scope_count++];
-    scope->variables = NULL;
-    scope->count = 0;
-    scope->capacity = 0;
+    scope->slots = interpreter->stack + interpreter->stack_top;
+    scope->count = slot_count;
+    for (size_t i = 0; i < slot_count; i++) {
+        scope->slots[i] = value_null();
+    }
+    interpreter->stack_top += slot_count;
+    return 1;
+}
+
+/* The argc values on top of the stack become the frame's first slots, so
+ * parameters bind in place; arguments past the last parameter are dropped. */
+int interpreter_push_frame(Interpreter *interpreter, ASTNode *func_node, int argc) {
+    size_t base = interpreter->stack_top - argc;
+    int params = 0;
+    for (ASTNode *param = func_node->left; param && params < argc; param = param->next) {
+        params++;
+    }
+    interpreter->stack_top = base + params;
+    if (!interpreter_push_scope(interpreter, func_node->local_count - params)) {
+        interpreter->stack_top = base + argc;
+        return 0;
+    }
+    Scope *frame = &interpreter->scopes[interpreter->scope_count - 1];
+    frame->slots -= params;
+    frame->count += params;
+    return 1;
 }
 
 void interpreter_pop_scope(Interpreter *interpreter) {
     if (interpreter->scope_count > 0) {
         interpreter->scope_count--;
-        Scope *scope = &interpreter->scopes[interpreter->scope_count];
-        for (size_t i = 0; i < scope->count; i++) {
-            free(scope->variables[i].name);
-        }
-        if (scope->variables) {
-            free(scope->variables);
+        interpreter->stack_top = interpreter->scopes[interpreter->scope_count].slots - interpreter->stack;
+    }
+}
+
+static int interpreter_push(Interpreter *interpreter, Value value) {
+    if (interpreter->stack_top >= INTERPRETER_STACK_SIZE) {
+        return interpreter_stack_overflow(interpreter);
+    }
+    interpreter->stack[interpreter->stack_top++] = value;
+    return 1;
+}
+
+/* Evaluates a call's arguments onto the value stack and returns how many
+ * there were. */
+static int interpreter_push_args(Interpreter *interpreter, ASTNode *arg) {
+    int argc = 0;
+    for (; arg; arg = arg->next) {
+        if (!interpreter_push(interpreter, interpreter_eval(interpreter, arg))) break;
+        argc++;
+    }
+    return argc;
+}
+
+/* Keeps an AST-walker temporary alive until the node that pushed it returns. */
+static void interpreter_push_temp(Interpreter *interpreter, Value value) {
+    if (interpreter->temp_count >= interpreter->temp_capacity) {
+        interpreter->temp_capacity = interpreter->temp_capacity == 0 ? 64 : interpreter->temp_capacity * 2;
+        interpreter->temps = tess_realloc(interpreter->temps, sizeof(Value) * interpreter->temp_capacity);
+    }
+    interpreter->temps[interpreter->temp_count++] = value;
+}
+
+static unsigned long global_hash(const char *name) {
+    unsigned long hash = 5381;
+    int c;
+    while ((c = *name++)) hash = ((hash << 5) + hash) + c;
+    return hash;
+}
+
+static void global_index_insert(Interpreter *interpreter, int slot) {
+    size_t mask = interpreter->global_index_capacity - 1;
+    size_t i = global_hash(interpreter->globals[slot].name) & mask;
+    while (interpreter->global_index[i] >= 0) {
+        i = (i + 1) & mask;
+    }
+    interpreter->global_index[i] = slot;
+}
+
+int interpreter_find_global(Interpreter *interpreter, const char *name) {
+    if (interpreter->global_index_capacity == 0) return -1;
+    
+    size_t mask = interpreter->global_index_capacity - 1;
+    size_t i = global_hash(name) & mask;
+    while (interpreter->global_index[i] >= 0) {
+        int slot = interpreter->global_index[i];
+        if (strcmp(interpreter->globals[slot].name, name) == 0) {
+            return slot;
+        }
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+int interpreter_global_slot(Interpreter *interpreter, const char *name) {
+    int slot = interpreter_find_global(interpreter, name);
+    if (slot >= 0) return slot;
+    
+    if (interpreter->global_count >= interpreter->global_capacity) {
+        interpreter->global_capacity = interpreter->global_capacity == 0 ? 64 : interpreter->global_capacity * 2;
+        interpreter->globals = tess_realloc(interpreter->globals, sizeof(Global) * interpreter->global_capacity);
+    }
+    slot = (int)interpreter->global_count++;
+    interpreter->globals[slot].name = tess_strdup(name);
+    interpreter->globals[slot].value = value_null();
+    interpreter->globals[slot].defined = 0;
+    
+    if (interpreter->global_count * 2 > interpreter->global_index_capacity) {
+        size_t new_capacity = interpreter->global_index_capacity == 0 ? 128 : interpreter->global_index_capacity * 2;
+        free(interpreter->global_index);
+        interpreter->global_index = tess_malloc(sizeof(int) * new_capacity);
+        memset(interpreter->global_index, 0xff, sizeof(int) * new_capacity);
+        interpreter->global_index_capacity = new_capacity;
+        for (size_t i = 0; i < interpreter->global_count; i++) {
+            global_index_insert(interpreter, (int)i);
         }
+    } else {
+        global_index_insert(interpreter, slot);
     }
+    return slot;
 }
 
 void interpreter_set_variable(Interpreter *interpreter, const char *name, Value value) {
-    if (interpreter->scope_count > 0) {
-        Scope *scope = &interpreter->scopes[interpreter->scope_count - 1];
-        
-        for (size_t i = 0; i < scope->count; i++) {
-            if (strcmp(scope->variables[i].name, name) == 0) {
-                scope->variables[i].value = value;
-                return;
+    int slot = interpreter_global_slot(interpreter, name);
+    interpreter->globals[slot].value = value;
+    interpreter->globals[slot].defined = 1;
+}
+
+Value interpreter_get_variable(Interpreter *interpreter, const char *name) {
+    int slot = interpreter_find_global(interpreter, name);
+    if (slot >= 0) {
+        return interpreter->globals[slot].value;
+    }
+    
+    return value_null();
+}
+
+static Value* interpreter_binding(Interpreter *interpreter, ASTNode *node) {
+    if (node->depth < 0) {
+        return &interpreter->globals[node->slot].value;
+    }
+    return &interpreter->scopes[interpreter->scope_count - 1 - node->depth].slots[node->slot];
+}
+
+void interpreter_print_value(Value val) {
+    if (value_type(val) == VALUE_NUMBER) {
+        printf("%g", value_as_number(val));
+    } else if (value_type(val) == VALUE_STRING) {
+        printf("%s", value_as_string(val));
+    } else if (value_type(val) == VALUE_NULL) {
+        printf("null");
+    } else if (value_type(val) == VALUE_BOOLEAN) {
+        printf(value_as_boolean(val) ? "true" : "false");
+    } else if (value_type(val) == VALUE_LIST) {
+        printf("[List]");
+    } else if (value_type(val) == VALUE_DICT) {
+        printf("[Dict]");
+    } else if (value_type(val) == VALUE_FILE) {
+        printf("[File Handle: %p]", value_as_file(val));
+    } else if (value_type(val) == VALUE_FUNCTION) {
+        printf("[Function]");
+    } else if (value_type(val) == VALUE_CLASS) {
+        printf("[Class]");
+    } else if (value_type(val) == VALUE_OBJECT) {
+        printf("[Object]");
+    }
+}
+
+Value interpreter_concat(Value left, Value right) {
+    char left_buf[32];
+    char right_buf[32];
+    char *left_str = NULL;
+    char *right_str = NULL;
+    
+    size_t left_len = 0;
+    size_t right_len = 0;
+    
+    if (value_type(left) == VALUE_STRING) {
+        left_str = value_as_string(left);
+        left_len = string_length(left_str);
+    }
+    else if (value_type(left) == VALUE_NUMBER) {
+        left_str = left_buf;
+        left_len = snprintf(left_buf, sizeof(left_buf), "%g", value_as_number(left));
+    }
+    
+    if (value_type(right) == VALUE_STRING) {
+        right_str = value_as_string(right);
+        right_len = string_length(right_str);
+    }
+    else if (value_type(right) == VALUE_NUMBER) {
+        right_str = right_buf;
+        right_len = snprintf(right_buf, sizeof(right_buf), "%g", value_as_number(right));
+    }
+    
+    Value result = value_null();
+    if (left_str && right_str) {
+        char *joined = gc_string(left_len + right_len);
+        memcpy(joined, left_str, left_len);
+        memcpy(joined + left_len, right_str, right_len);
+        result = value_string(joined);
+    }
+    
+    return result;
+}
+
+/* target + parts[0] + ... + parts[count - 1], appending to target in place
+ * while it is a string and each part is a string or a number. */
+Value interpreter_append(Value target, Value *parts, int count) {
+    int i = 0;
+    if (value_type(target) == VALUE_STRING) {
+        char *str = value_as_string(target);
+        char digits[32];
+        for (; i < count; i++) {
+            if (value_type(parts[i]) == VALUE_STRING) {
+                char *part = value_as_string(parts[i]);
+                str = gc_string_append(str, part, string_length(part));
+            } else if (value_type(parts[i]) == VALUE_NUMBER) {
+                int length = snprintf(digits, sizeof(digits), "%g", value_as_number(parts[i]));
+                str = gc_string_append(str, digits, length);
+            } else {
+                break;
             }
         }
-        
-        if (scope->count >= scope->capacity) {
-            size_t new_capacity = scope->capacity == 0 ? 4 : scope->capacity * 2;
-            scope->variables = realloc(scope->variables,
-                                     sizeof(Variable) * new_capacity);
-            scope->capacity = new_capacity;
+        target = value_string(str);
+    }
+    for (; i < count; i++) {
+        target = interpreter_binary_op(BINOP_ADD, target, parts[i]);
+    }
+    return target;
+}
+
+Value interpreter_binary_op(BinaryOperator op, Value left, Value right) {
+    if (value_type(left) == VALUE_NUMBER && value_type(right) == VALUE_NUMBER) {
+        double x = value_as_number(left);
+        double y = value_as_number(right);
+        double result = 0;
+        switch (op) {
+            case BINOP_ADD: result = x + y; break;
+            case BINOP_SUB: result = x - y; break;
+            case BINOP_MUL: result = x * y; break;
+            case BINOP_DIV: result = x / y; break;
+            case BINOP_MOD: result = fmod(x, y); break;
+            case BINOP_GT: result = x > y; break;
+            case BINOP_LT: result = x < y; break;
+            case BINOP_EQ: result = x == y; break;
+            case BINOP_NEQ: result = x != y; break;
+            case BINOP_GTE: result = x >= y; break;
+            case BINOP_LTE: result = x <= y; break;
+        }
+        return value_number(result);
+    }
+    
+    if (op == BINOP_ADD) {
+        return interpreter_concat(left, right);
+    }
+    
+    if ((op == BINOP_EQ || op == BINOP_NEQ) && value_type(left) == VALUE_STRING && value_type(right) == VALUE_STRING) {
+        int equal = strcmp(value_as_string(left), value_as_string(right)) == 0;
+        return value_number(op == BINOP_EQ ? equal : !equal);
+    }
+    
+    return value_null();
+}
+
+Value interpreter_index(Interpreter *interpreter, Value collection, Value index) {
+    if (value_type(collection) == VALUE_LIST && value_type(index) == VALUE_NUMBER) {
+        int idx = (int)value_as_number(index);
+        List *list = value_as_list(collection);
+        if (idx >= 0 && idx < (int)list->count) {
+            return list->items[idx];
+        } else {
+            printf("Error: List index out of range: %d\n", idx);
+            interpreter->error_occurred = 1;
+        }
+    } else if (value_type(collection) == VALUE_STRING && value_type(index) == VALUE_NUMBER) {
+        int idx = (int)value_as_number(index);
+        char *str = value_as_string(collection);
+        if (idx >= 0 && (size_t)idx < string_length(str)) {
+            return value_string(gc_substring(str + idx, 1));
+        }
+    } else if (value_type(collection) == VALUE_DICT && value_type(index) == VALUE_STRING) {
+        Value *value = dict_find(value_as_dict(collection), value_as_string(index));
+        if (value) {
+            return *value;
         }
+    }
+    return value_null();
+}
+
+Value interpreter_new_object(Value class_val) {
+    if (value_type(class_val) != VALUE_CLASS) {
+        return value_null();
+    }
+    
+    return value_object(gc_new_object(shape_for_class(value_as_class(class_val))));
+}
+
+int interpreter_find_member(Value object, const char *name, Value *out) {
+    if (value_type(object) != VALUE_OBJECT) return 0;
+    return shape_find(value_as_object(object), name, out);
+}
+
+BuiltinFunc interpreter_file_method(const char *name) {
+    if (strcmp(name, "write") == 0) return (BuiltinFunc)stdlib_file_write;
+    if (strcmp(name, "read") == 0) return (BuiltinFunc)stdlib_file_read;
+    if (strcmp(name, "close") == 0) return (BuiltinFunc)stdlib_file_close;
+    return NULL;
+}
+
+Value interpreter_http_request(Value method_val, Value url_val, Value *data_val) {
+    if (value_type(method_val) != VALUE_STRING || value_type(url_val) != VALUE_STRING) {
+        return value_string(gc_strdup("HTTP Error: Method and URL must be strings"));
+    }
+    
+    const char *method = value_as_string(method_val);
+    const char *url = value_as_string(url_val);
+    const char *data = NULL;
+    const char **headers = NULL;
+    int header_count = 0;
+    
+    if (data_val && value_type(*data_val) == VALUE_STRING) {
+        data = value_as_string(*data_val);
         
-        scope->variables[scope->count].name = strdup(name);
-        scope->variables[scope->count].value = value;
-        scope->count++;
+        if (strcmp(method, "POST") == 0 || strcmp(method, "PUT") == 0) {
+            headers = tess_malloc(sizeof(char*) * 1);
+            headers[0] = "Content-Type: application/json";
+            header_count = 1;
+        }
     }
+    
+    char *response = http_request(method, url, data, headers, header_count);
+    
+    if (!response) {
+        Value error_val = value_string(gc_strdup("HTTP Error: http_request returned NULL"));
+        if (headers) free(headers);
+        return error_val;
+    }
+    
+    Value result = value_string(gc_strdup(response));
+    
+    free(response);
+    if (headers) free(headers);
+    
+    return result;
 }
 
-Value interpreter_get_variable(Interpreter *interpreter, const char *name) {
-    for (int i = interpreter->scope_count - 1; i >= 0; i--) {
-        Scope *scope = &interpreter->scopes[i];
-        for (size_t j = 0; j < scope->count; j++) {
-            if (strcmp(scope->variables[j].name, name) == 0) {
-                return scope->variables[j].value;
-            }
+Value interpreter_take_error(Interpreter *interpreter) {
+    Value err_val = value_null();
+    interpreter->error_occurred = 0;
+    if (error_message) {
+        err_val = value_string(gc_strdup(error_message));
+        free(error_message);
+        error_message = NULL;
+    }
+    return err_val;
+}
+
+void interpreter_import(Interpreter *interpreter, const char *module_name) {
+    module_import(interpreter, module_name);
+}
+
+/* Consumes a break or continue at the loop that owns it; a return keeps
+ * unwinding to the enclosing call. */
+static int interpreter_loop_exit(Interpreter *interpreter) {
+    switch (interpreter->completion) {
+        case COMPLETION_NORMAL:
+            return 0;
+        case COMPLETION_CONTINUE:
+            interpreter->completion = COMPLETION_NORMAL;
+            return 0;
+        case COMPLETION_BREAK:
+            interpreter->completion = COMPLETION_NORMAL;
+            return 1;
+        default:
+            return 1;
+    }
+}
+
+/* Calls func_node with the argc values on top of the stack as arguments,
+ * popping them. */
+static Value interpreter_invoke(Interpreter *interpreter, ASTNode *func_node, int argc) {
+    Value result = value_null();
+    ASTNode *body = func_node->children;
+    uintptr_t here = (uintptr_t)&result;
+    size_t used = here < interpreter->c_stack_base ? interpreter->c_stack_base - here : here - interpreter->c_stack_base;
+    if (interpreter->call_depth >= interpreter->max_depth || used > interpreter->c_stack_budget) {
+        interpreter_stack_overflow(interpreter);
+        body = NULL;
+    }
+    if (!body || !interpreter_push_frame(interpreter, func_node, argc)) {
+        interpreter->stack_top -= argc;
+        return result;
+    }
+    
+    interpreter->call_depth++;
+    int in_loop = interpreter->in_loop;
+    interpreter->in_loop = 0;
+    
+    if (body->type == AST_BLOCK || body->type == AST_INNER_BLOCK) {
+        ASTNode *stmt = body->children;
+        while (stmt && interpreter->completion == COMPLETION_NORMAL) {
+            interpreter_eval(interpreter, stmt);
+            stmt = stmt->next;
         }
+    } else {
+        interpreter_eval(interpreter, body);
     }
     
-    Value val = {VALUE_NULL, {0}};
-    return val;
+    if (interpreter->completion == COMPLETION_RETURN) {
+        result = interpreter->return_value;
+    }
+    interpreter->completion = COMPLETION_NORMAL;
+    interpreter->in_loop = in_loop;
+    interpreter->call_depth--;
+    interpreter_pop_scope(interpreter);
+    fflush(stdout);
+    return result;
 }
 
-Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
+/* Calls a builtin with the argc values on top of the stack, popping them. */
+static Value interpreter_call_builtin(Interpreter *interpreter, BuiltinFunc func, int argc) {
+    Value result = func(interpreter->stack + interpreter->stack_top - argc, argc);
+    interpreter->stack_top -= argc;
+    return result;
+}
+
+/* Pushes the operands of x = x + a + b ... as temps, in evaluation order. */
+static void interpreter_eval_appends(Interpreter *interpreter, ASTNode *sum) {
+    if (sum->left->type == AST_BINARY_OP) {
+        interpreter_eval_appends(interpreter, sum->left);
+    }
+    interpreter_push_temp(interpreter, interpreter_eval(interpreter, sum->right));
+}
+
+static Value interpreter_eval_node(Interpreter *interpreter, ASTNode *node) {
     if (!node) {
-        Value val = {VALUE_NULL, {0}};
-        return val;
+        return value_null();
     }
     
     if (interpreter->error_occurred && node->type != AST_CATCH) {
-        return (Value){VALUE_NULL, {0}};
+        return value_null();
     }
 
     switch (node->type) {
         case AST_PROGRAM: {
             ASTNode *stmt = node->children;
-            Value result = {VALUE_NULL, {0}};
-            while (stmt) {
+            Value result = value_null();
+            while (stmt && interpreter->completion == COMPLETION_NORMAL) {
                 result = interpreter_eval(interpreter, stmt);
                 stmt = stmt->next;
             }
@@ -132,108 +581,46 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
         }
 
         case AST_NUMBER: {
-            Value val;
-            val.type = VALUE_NUMBER;
-            val.as.number = strtod(node->value, NULL);
-            return val;
+            return value_number(node->number);
         }
         
         case AST_STRING: {
-            Value val;
-            val.type = VALUE_STRING;
-            val.as.string = strdup(node->value);
-            return val;
+            return value_string(node->value);
         }
         
         case AST_BINARY_OP: {
             Value left = interpreter_eval(interpreter, node->left);
+            interpreter_push_temp(interpreter, left);
             Value right = interpreter_eval(interpreter, node->right);
-            
-            if (left.type == VALUE_NUMBER && right.type == VALUE_NUMBER) {
-                Value result;
-                result.type = VALUE_NUMBER;
-                if (strcmp(node->value, "+") == 0) result.as.number = left.as.number + right.as.number;
-                else if (strcmp(node->value, "-") == 0) result.as.number = left.as.number - right.as.number;
-                else if (strcmp(node->value, "*") == 0) result.as.number = left.as.number * right.as.number;
-                else if (strcmp(node->value, "/") == 0) result.as.number = left.as.number / right.as.number;
-                else if (strcmp(node->value, "%") == 0) result.as.number = fmod(left.as.number, right.as.number);
-                else if (strcmp(node->value, ">") == 0) result.as.number = left.as.number > right.as.number;
-                else if (strcmp(node->value, "<") == 0) result.as.number = left.as.number < right.as.number;
-                else if (strcmp(node->value, "==") == 0) result.as.number = left.as.number == right.as.number;
-                else if (strcmp(node->value, "<=") == 0) result.as.number = left.as.number <= right.as.number;
-                else if (strcmp(node->value, ">=") == 0) result.as.number = left.as.number >= right.as.number;
-                return result;
-            }
-            
-            if (strcmp(node->value, "+") == 0) {
-                char *left_str = NULL;
-                char *right_str = NULL;
-                
-                if (left.type == VALUE_STRING) left_str = left.as.string;
-                else if (left.type == VALUE_NUMBER) {
-                    left_str = malloc(64);
-                    snprintf(left_str, 64, "%g", left.as.number);
-                }
-                
-                if (right.type == VALUE_STRING) right_str = right.as.string;
-                else if (right.type == VALUE_NUMBER) {
-                    right_str = malloc(64);
-                    snprintf(right_str, 64, "%g", right.as.number);
-                }
-                
-                if (left_str && right_str) {
-                    size_t len = strlen(left_str) + strlen(right_str) + 1;
-                    Value result;
-                    result.type = VALUE_STRING;
-                    result.as.string = malloc(len);
-                    snprintf(result.as.string, len, "%s%s", left_str, right_str);
-                    
-                    if (left.type != VALUE_STRING && left_str) free(left_str);
-                    if (right.type != VALUE_STRING && right_str) free(right_str);
-                    
-                    return result;
-                }
-            }
-            break;
+            return interpreter_binary_op(node->op, left, right);
         }
         
         case AST_ASSIGNMENT: {
+            if (node->appends > 0) {
+                size_t base = interpreter->temp_count;
+                interpreter_eval_appends(interpreter, node->right);
+                Value *binding = interpreter_binding(interpreter, node);
+                *binding = interpreter_append(*binding, &interpreter->temps[base], node->appends);
+                return *binding;
+            }
             Value val = interpreter_eval(interpreter, node->right);
-            interpreter_set_variable(interpreter, node->value, val);
+            *interpreter_binding(interpreter, node) = val;
             return val;
         }
         
         case AST_IDENTIFIER: {
-            return interpreter_get_variable(interpreter, node->value);
+            Value val = *interpreter_binding(interpreter, node);
+            string_finish(val);
+            return val;
         }
         
         case AST_PRINT: {
             ASTNode *expr = node->left;
-            Value last_val = {VALUE_NULL, {0}};
+            Value last_val = value_null();
             
             while (expr) {
                 Value val = interpreter_eval(interpreter, expr);
-                if (val.type == VALUE_NUMBER) {
-                    printf("%g", val.as.number);
-                } else if (val.type == VALUE_STRING) {
-                    printf("%s", val.as.string);
-                } else if (val.type == VALUE_NULL) {
-                    printf("null");
-                } else if (val.type == VALUE_BOOLEAN) {
-                    printf(val.as.boolean ? "true" : "false");
-                } else if (val.type == VALUE_LIST) {
-                    printf("[List]");
-                } else if (val.type == VALUE_DICT) {
-                    printf("[Dict]");
-                } else if (val.type == VALUE_FILE) {
-                    printf("[File Handle: %p]", val.as.file);
-                } else if (val.type == VALUE_FUNCTION) {
-                    printf("[Function]");
-                } else if (val.type == VALUE_CLASS) {
-                    printf("[Class]");
-                } else if (val.type == VALUE_OBJECT) {
-                    printf("[Object]");
-                }
+                interpreter_print_value(val);
                 
                 if (expr->next) printf(" ");
                 last_val = val;
@@ -244,47 +631,42 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
             return last_val;
         }
         
-        case AST_BLOCK: {
-            interpreter_push_scope(interpreter);
+        case AST_BLOCK:
+        case AST_INNER_BLOCK: {
+            int scoped = node->type == AST_BLOCK;
+            if (scoped && !interpreter_push_scope(interpreter, node->local_count)) return value_null();
             ASTNode *stmt = node->children;
-            Value result = {VALUE_NULL, {0}};
-            while (stmt) {
+            Value result = value_null();
+            while (stmt && interpreter->completion == COMPLETION_NORMAL) {
                 result = interpreter_eval(interpreter, stmt);
-                Value ret_check = interpreter_get_variable(interpreter, "__return__");
-                if (ret_check.type == VALUE_NUMBER && ret_check.as.number == 1) {
-                    result = interpreter_get_variable(interpreter, "__return_value__");
-                    interpreter_set_variable(interpreter, "__return__", (Value){VALUE_NULL, {0}});
-                    interpreter_pop_scope(interpreter);
-                    return result;
-                }
-                if (interpreter->break_loop || interpreter->continue_loop) {
-                    break;
-                }
                 stmt = stmt->next;
             }
-            interpreter_pop_scope(interpreter);
+            if (scoped) interpreter_pop_scope(interpreter);
             return result;
         }
         
+        case AST_IF: {
+            Value cond_val = interpreter_eval(interpreter, node->left);
+            if (interpreter_is_truthy(cond_val)) {
+                return interpreter_eval(interpreter, node->children);
+            }
+            if (node->right) {
+                return interpreter_eval(interpreter, node->right);
+            }
+            break;
+        }
+        
         case AST_REPEAT: {
             ASTNode *count_node = node->left;
             ASTNode *block_node = node->children;
             Value count_val = interpreter_eval(interpreter, count_node);
             
-            if (count_val.type == VALUE_NUMBER) {
-                int count = (int)count_val.as.number;
+            if (value_type(count_val) == VALUE_NUMBER) {
+                int count = (int)value_as_number(count_val);
                 interpreter->in_loop++;
                 for (int i = 0; i < count; i++) {
                     interpreter_eval(interpreter, block_node);
-                    
-                    if (interpreter->break_loop) {
-                        interpreter->break_loop = 0;
-                        break;
-                    }
-                    if (interpreter->continue_loop) {
-                        interpreter->continue_loop = 0;
-                        continue;
-                    }
+                    if (interpreter_loop_exit(interpreter)) break;
                 }
                 interpreter->in_loop--;
             }
@@ -298,20 +680,10 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
             interpreter->in_loop++;
             while (1) {
                 Value cond_val = interpreter_eval(interpreter, condition);
-                if (cond_val.type == VALUE_NUMBER && cond_val.as.number == 0) break;
-                if (cond_val.type == VALUE_NULL) break;
-                if (cond_val.type == VALUE_BOOLEAN && !cond_val.as.boolean) break;
+                if (!interpreter_is_truthy(cond_val)) break;
                 
                 interpreter_eval(interpreter, block);
-                
-                if (interpreter->break_loop) {
-                    interpreter->break_loop = 0;
-                    break;
-                }
-                if (interpreter->continue_loop) {
-                    interpreter->continue_loop = 0;
-                    continue;
-                }
+                if (interpreter_loop_exit(interpreter)) break;
             }
             interpreter->in_loop--;
             break;
@@ -319,23 +691,20 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
         
         case AST_BREAK:
             if (interpreter->in_loop) {
-                interpreter->break_loop = 1;
+                interpreter->completion = COMPLETION_BREAK;
             }
             break;
             
         case AST_CONTINUE:
             if (interpreter->in_loop) {
-                interpreter->continue_loop = 1;
+                interpreter->completion = COMPLETION_CONTINUE;
             }
             break;
             
         case AST_RETURN: {
             Value ret_val = interpreter_eval(interpreter, node->left);
-            Value return_wrapper;
-            return_wrapper.type = VALUE_NUMBER;
-            return_wrapper.as.number = 1;
-            interpreter_set_variable(interpreter, "__return__", return_wrapper);
-            interpreter_set_variable(interpreter, "__return_value__", ret_val);
+            interpreter->return_value = ret_val;
+            interpreter->completion = COMPLETION_RETURN;
             return ret_val;
         }
             
@@ -347,16 +716,9 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
             Value result = interpreter_eval(interpreter, try_block);
             
             if (interpreter->error_occurred) {
-                interpreter->error_occurred = 0;
-                interpreter_push_scope(interpreter);
-                if (error_message) {
-                    Value err_val;
-                    err_val.type = VALUE_STRING;
-                    err_val.as.string = strdup(error_message);
-                    interpreter_set_variable(interpreter, "error", err_val);
-                    free(error_message);
-                    error_message = NULL;
-                }
+                Value error = interpreter_take_error(interpreter);
+                if (!interpreter_push_scope(interpreter, node->local_count)) return value_null();
+                interpreter->scopes[interpreter->scope_count - 1].slots[0] = error;
                 Value catch_res = interpreter_eval(interpreter, catch_block);
                 interpreter_pop_scope(interpreter);
                 return catch_res;
@@ -364,260 +726,96 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
             return result;
         }
         
-        case AST_NEW: {
-            char *class_name = node->value;
-            Value class_val = interpreter_get_variable(interpreter, class_name);
-            
-            if (class_val.type == VALUE_CLASS) {
-                Value obj;
-                obj.type = VALUE_OBJECT;
-                obj.as.dict = malloc(sizeof(Dict));
-                Dict *instance = obj.as.dict;
-                instance->bucket_count = 16;
-                instance->buckets = calloc(instance->bucket_count, sizeof(DictEntry*));
-                instance->count = 0;
-                
-                ASTNode *class_def = class_val.as.class_def;
-                ASTNode *member = class_def->children;
-                while (member) {
-                    if (member->type == AST_FUNCTION_DEF) {
-                        Value method_val;
-                        method_val.type = VALUE_FUNCTION;
-                        method_val.as.function = member;
-                        
-                        unsigned long hash = 5381;
-                        int c;
-                        char *str = member->value;
-                        while ((c = *str++)) hash = ((hash << 5) + hash) + c;
-                        size_t index = hash % instance->bucket_count;
-                        
-                        DictEntry *entry = malloc(sizeof(DictEntry));
-                        entry->key = strdup(member->value);
-                        entry->value = malloc(sizeof(Value));
-                        *entry->value = method_val;
-                        entry->next = instance->buckets[index];
-                        instance->buckets[index] = entry;
-                        instance->count++;
-                    }
-                    member = member->next;
-                }
-                
-                return obj;
-            }
-            break;
-        }
+        case AST_NEW:
+            return interpreter_new_object(*interpreter_binding(interpreter, node));
         
         case AST_LIST: {
-            Value list_val;
-            list_val.type = VALUE_LIST;
-            list_val.as.list = malloc(sizeof(List));
-            List *list = list_val.as.list;
-            list->count = 0;
-            list->capacity = 4;
-            list->items = malloc(sizeof(Value) * list->capacity);
+            List *list = gc_new_list(4);
+            interpreter_push_temp(interpreter, value_list(list));
             
             ASTNode *item = node->children;
             while (item) {
                 if (list->count >= list->capacity) {
                     list->capacity *= 2;
-                    list->items = realloc(list->items, sizeof(Value) * list->capacity);
+                    list->items = tess_realloc(list->items, sizeof(Value) * list->capacity);
                 }
-                list->items[list->count++] = interpreter_eval(interpreter, item);
+                Value value = interpreter_eval(interpreter, item);
+                list->items[list->count++] = value;
                 item = item->next;
             }
-            return list_val;
+            return value_list(list);
         }
         
         case AST_DICT: {
-            Value dict_val;
-            dict_val.type = VALUE_DICT;
-            dict_val.as.dict = malloc(sizeof(Dict));
-            Dict *dict = dict_val.as.dict;
-            dict->bucket_count = 16;
-            dict->buckets = calloc(dict->bucket_count, sizeof(DictEntry*));
-            dict->count = 0;
+            Dict *dict = gc_new_dict(16);
             
             ASTNode *pair = node->children;
             (void)pair;
-            return dict_val;
+            return value_dict(dict);
         }
         
         case AST_INDEX: {
             Value collection = interpreter_eval(interpreter, node->left);
+            interpreter_push_temp(interpreter, collection);
             Value index = interpreter_eval(interpreter, node->right);
-            
-            if (collection.type == VALUE_LIST && index.type == VALUE_NUMBER) {
-                int idx = (int)index.as.number;
-                List *list = collection.as.list;
-                if (idx >= 0 && idx < (int)list->count) {
-                    return list->items[idx];
-                } else {
-                    printf("Error: List index out of range: %d\n", idx);
-                    interpreter->error_occurred = 1;
-                }
-            } else if (collection.type == VALUE_STRING && index.type == VALUE_NUMBER) {
-                int idx = (int)index.as.number;
-                char *str = collection.as.string;
-                if (idx >= 0 && idx < (int)strlen(str)) {
-                    char res[2];
-                    res[0] = str[idx];
-                    res[1] = '\0';
-                    Value v; v.type = VALUE_STRING; v.as.string = strdup(res);
-                    return v;
-                }
-            } else if (collection.type == VALUE_DICT && index.type == VALUE_STRING) {
-                Dict *dict = collection.as.dict;
-                char *key = index.as.string;
-                unsigned long hash = 5381;
-                int c;
-                char *k = key;
-                while ((c = *k++)) hash = ((hash << 5) + hash) + c;
-                size_t bucket_idx = hash % dict->bucket_count;
-                
-                DictEntry *entry = dict->buckets[bucket_idx];
-                while (entry) {
-                    if (strcmp(entry->key, key) == 0) {
-                        return *entry->value;
-                    }
-                    entry = entry->next;
-                }
-            }
-            break;
+            return interpreter_index(interpreter, collection, index);
         }
         
         case AST_MEMBER_ACCESS: {
             Value obj = interpreter_eval(interpreter, node->left);
-            char *member_name = node->right->value;
+            interpreter_push_temp(interpreter, obj);
+            InlineCache *cache = inline_cache_for(node);
             
-            if (obj.type == VALUE_FILE) {
-                BuiltinFunc func = NULL;
-                if (strcmp(member_name, "write") == 0) func = (BuiltinFunc)stdlib_file_write;
-                else if (strcmp(member_name, "read") == 0) func = (BuiltinFunc)stdlib_file_read;
-                else if (strcmp(member_name, "close") == 0) func = (BuiltinFunc)stdlib_file_close;
+            if (value_type(obj) == VALUE_FILE) {
+                BuiltinFunc func = cache->file_method;
                 
                 if (func) {
-                    Value args[16];
-                    args[0] = obj;
+                    if (!interpreter_push(interpreter, obj)) return value_null();
                     int argc = 1;
-                    
-                    if (node->children || (node->value && strcmp(node->value, "call") == 0)) {
-                        ASTNode *arg_node = node->children;
-                        while (arg_node && argc < 16) {
-                            args[argc++] = interpreter_eval(interpreter, arg_node);
-                            arg_node = arg_node->next;
-                        }
+                    if (node->call) {
+                        argc += interpreter_push_args(interpreter, node->children);
                     }
-                    
-                    return func(args, argc);
+                    return interpreter_call_builtin(interpreter, func, argc);
                 }
             }
 
-            if (obj.type == VALUE_OBJECT) {
-                Dict *dict = obj.as.dict;
-                unsigned long hash = 5381;
-                int c;
-                char *k = member_name;
-                while ((c = *k++)) hash = ((hash << 5) + hash) + c;
-                size_t bucket_idx = hash % dict->bucket_count;
-                
-                DictEntry *entry = dict->buckets[bucket_idx];
-                while (entry) {
-                    if (strcmp(entry->key, member_name) == 0) {
-                        Value val = *entry->value;
+            Value val;
+            if (inline_cache_find(cache, obj, &val)) {
+                if (node->call) {
+                     if (value_type(val) == VALUE_FUNCTION) {
+                        ASTNode *func_node = value_as_function(val);
                         
-                        if (node->children || (node->value && strcmp(node->value, "call") == 0)) { 
-                             if (val.type == VALUE_FUNCTION) {
-                                ASTNode *func_node = val.as.function;
-                                
-                                if (!func_node) {
-                                    BuiltinFunc builtin = get_builtin(member_name);
-                                    if (builtin) {
-                                        Value args[16];
-                                        args[0] = obj;
-                                        int argc = 1;
-                                        
-                                        ASTNode *arg_node = node->children;
-                                        while (arg_node && argc < 16) {
-                                            args[argc++] = interpreter_eval(interpreter, arg_node);
-                                            arg_node = arg_node->next;
-                                        }
-                                        return builtin(args, argc);
-                                    }
-                                    return (Value){VALUE_NULL, {0}};
-                                }
-
-                                Value args[16];
-                                int argc = 0;
-                                ASTNode *arg_node = node->children;
-                                while (arg_node && argc < 16) {
-                                    args[argc++] = interpreter_eval(interpreter, arg_node);
-                                    arg_node = arg_node->next;
-                                }
-                                
-                                interpreter_push_scope(interpreter);
-                                
-                                ASTNode *param = func_node->left;
-                                int arg_idx = 0;
-                                while (param && arg_idx < argc) {
-                                    if (param->value) {
-                                        interpreter_set_variable(interpreter, param->value, args[arg_idx]);
-                                    }
-                                    param = param->next;
-                                    arg_idx++;
-                                }
-                                
-                                ASTNode *body = func_node->children;
-                                Value res = {VALUE_NULL, {0}};
-                                
-                                if (body && (body->type == AST_BLOCK || body->type == AST_INNER_BLOCK)) {
-                                    ASTNode *stmt = body->children;
-                                    while (stmt) {
-                                        res = interpreter_eval(interpreter, stmt);
-                                        Value ret_check = interpreter_get_variable(interpreter, "__return__");
-                                        if (ret_check.type == VALUE_NUMBER && ret_check.as.number == 1) {
-                                            res = interpreter_get_variable(interpreter, "__return_value__");
-                                            interpreter_set_variable(interpreter, "__return__", (Value){VALUE_NULL, {0}});
-                                            interpreter_pop_scope(interpreter);
-                                            return res;
-                                        }
-                                        if (stmt->type == AST_BREAK || stmt->type == AST_CONTINUE) break;
-                                        stmt = stmt->next;
-                                    }
-                                } else if (body) {
-                                    res = interpreter_eval(interpreter, body);
-                                    Value ret_check = interpreter_get_variable(interpreter, "__return__");
-                                    if (ret_check.type == VALUE_NUMBER && ret_check.as.number == 1) {
-                                        res = interpreter_get_variable(interpreter, "__return_value__");
-                                        interpreter_set_variable(interpreter, "__return__", (Value){VALUE_NULL, {0}});
-                                    }
-                                }
-                                
-                                interpreter_pop_scope(interpreter);
-                                return res;
-                             }
+                        if (!func_node) {
+                            BuiltinFunc builtin = cache->builtin;
+                            if (builtin) {
+                                if (!interpreter_push(interpreter, obj)) return value_null();
+                                int argc = 1 + interpreter_push_args(interpreter, node->children);
+                                return interpreter_call_builtin(interpreter, builtin, argc);
+                            }
+                            return value_null();
                         }
-                        
-                        return val;
-                    }
-                    entry = entry->next;
+
+                        int argc = interpreter_push_args(interpreter, node->children);
+                        return interpreter_invoke(interpreter, func_node, argc);
+                     }
                 }
+                
+                return val;
             }
             break;
         }
         
         case AST_FUNCTION_DEF: {
-            Value val;
-            val.type = VALUE_FUNCTION;
-            val.as.function = node;
-            interpreter_set_variable(interpreter, node->value, val);
+            if (!node->value) break;
+            Value val = value_function(node);
+            *interpreter_binding(interpreter, node) = val;
             break;
         }
         
         case AST_CLASS_DEF: {
-            Value val;
-            val.type = VALUE_CLASS;
-            val.as.class_def = node;
-            interpreter_set_variable(interpreter, node->value, val);
+            if (!node->value) break;
+            Value val = value_class(node);
+            *interpreter_binding(interpreter, node) = val;
             break;
         }
         
@@ -629,68 +827,19 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
             
         case AST_HTTP_REQUEST: {
             if (!node->left || !node->right) {
-                Value error_val;
-                error_val.type = VALUE_STRING;
-                error_val.as.string = strdup("HTTP Error: Missing method or URL");
-                return error_val;
+                return value_string(gc_strdup("HTTP Error: Missing method or URL"));
             }
             
             Value method_val = interpreter_eval(interpreter, node->left);
+            interpreter_push_temp(interpreter, method_val);
             Value url_val = interpreter_eval(interpreter, node->right);
-            
-            if (method_val.type != VALUE_STRING || url_val.type != VALUE_STRING) {
-                Value error_val;
-                error_val.type = VALUE_STRING;
-                error_val.as.string = strdup("HTTP Error: Method and URL must be strings");
-                if (method_val.type == VALUE_STRING) free(method_val.as.string);
-                if (url_val.type == VALUE_STRING) free(url_val.as.string);
-                return error_val;
-            }
-            
-            char *method = method_val.as.string;
-            char *url = url_val.as.string;
-            char *data = NULL;
-            const char **headers = NULL;
-            int header_count = 0;
+            interpreter_push_temp(interpreter, url_val);
             
             if (node->children) {
                 Value data_val = interpreter_eval(interpreter, node->children);
-                if (data_val.type == VALUE_STRING) {
-                    data = data_val.as.string;
-                    
-                    if (strcmp(method, "POST") == 0 || strcmp(method, "PUT") == 0) {
-                        headers = malloc(sizeof(char*) * 1);
-                        headers[0] = "Content-Type: application/json";
-                        header_count = 1;
-                    }
-                } else {
-                    free(data_val.as.string);
-                }
-            }
-            
-            char *response = http_request(method, url, data, headers, header_count);
-            
-            if (!response) {
-                Value error_val;
-                error_val.type = VALUE_STRING;
-                error_val.as.string = strdup("HTTP Error: http_request returned NULL");
-                free(method_val.as.string);
-                free(url_val.as.string);
-                if (data) free(data);
-                if (headers) free(headers);
-                return error_val;
+                return interpreter_http_request(method_val, url_val, &data_val);
             }
-            
-            Value result;
-            result.type = VALUE_STRING;
-            result.as.string = response;
-            
-            free(method_val.as.string);
-            free(url_val.as.string);
-            if (data) free(data);
-            if (headers) free(headers);
-            
-            return result;
+            return interpreter_http_request(method_val, url_val, NULL);
         }
 
         case AST_START: {
@@ -699,10 +848,7 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
         
         case AST_IMPORT: {
             if (node->value) {
-                ASTNode *module_ast = module_load(node->value);
-                if (module_ast) {
-                    module_execute(interpreter, module_ast);
-                }
+                interpreter_import(interpreter, node->value);
             }
             break;
         }
@@ -711,122 +857,41 @@ Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
             break;
     }
     
-    Value null_value = {VALUE_NULL, {0}};
-    return null_value;
+    return value_null();
+}
+
+/* Collection only happens here, between nodes, so every value a node is
+ * still holding has been pushed as a temporary or stored in a root. */
+Value interpreter_eval(Interpreter *interpreter, ASTNode *node) {
+    if (gc_pending) gc_collect(interpreter);
+    size_t temp_count = interpreter->temp_count;
+    Value result = interpreter_eval_node(interpreter, node);
+    interpreter->temp_count = temp_count;
+    return result;
 }
 
 Value interpreter_call_function(Interpreter *interpreter, ASTNode *node) {
-    char *func_name = strdup("main");
-    
-    if (node->type == AST_FUNCTION_CALL && node->value) {
-        if (strlen(node->value) > 2 && node->value[0] == '>' && node->value[strlen(node->value)-1] == '<') {
-            size_t len = strlen(node->value) - 2;
-            free(func_name);
-            func_name = malloc(len + 1);
-            memcpy(func_name, node->value + 1, len);
-            func_name[len] = '\0';
-        } else {
-            free(func_name);
-            func_name = strdup(node->value);
-        }
-    } else {
-    }
-    
-    BuiltinFunc builtin = get_builtin(func_name);
+    BuiltinFunc builtin = node->builtin;
     if (builtin) {
-        Value args[16];
-        int argc = 0;
-        ASTNode *arg_node = node->left;
-        while (arg_node && argc < 16) {
-            args[argc++] = interpreter_eval(interpreter, arg_node);
-            arg_node = arg_node->next;
-        }
-        Value result = builtin(args, argc);
-        free(func_name);
-        return result;
+        int argc = interpreter_push_args(interpreter, node->left);
+        return interpreter_call_builtin(interpreter, builtin, argc);
     }
     
-    Value func_value = interpreter_get_variable(interpreter, func_name);
+    Value func_value = *interpreter_binding(interpreter, node);
     
-    if (func_value.type == VALUE_FUNCTION && func_value.as.function) {
-        ASTNode *func_node = func_value.as.function;
+    if (value_type(func_value) == VALUE_FUNCTION && value_as_function(func_value)) {
+        ASTNode *func_node = value_as_function(func_value);
         
-        Value args[16];
-        int argc = 0;
-        ASTNode *arg_node = node->left;
-        while (arg_node && argc < 16) {
-            args[argc++] = interpreter_eval(interpreter, arg_node);
-            arg_node = arg_node->next;
-        }
-        
-        if (func_node->children) {
-            interpreter_push_scope(interpreter);
-            
-            ASTNode *param = func_node->left;
-            int arg_idx = 0;
-            while (param && arg_idx < argc) {
-                if (param->value) {
-                    interpreter_set_variable(interpreter, param->value, args[arg_idx]);
-                }
-                param = param->next;
-                arg_idx++;
-            }
-            
-            ASTNode *body = func_node->children;
-            
-            if (body->type == AST_BLOCK || body->type == AST_INNER_BLOCK) {
-                ASTNode *stmt = body->children;
-                Value result = {VALUE_NULL, {0}};
-                while (stmt) {
-                    result = interpreter_eval(interpreter, stmt);
-                    Value ret_check = interpreter_get_variable(interpreter, "__return__");
-                    if (ret_check.type == VALUE_NUMBER && ret_check.as.number == 1) {
-                        result = interpreter_get_variable(interpreter, "__return_value__");
-                        interpreter_pop_scope(interpreter);
-                        interpreter_set_variable(interpreter, "__return__", ret_check);
-                        interpreter_set_variable(interpreter, "__return_value__", result);
-                        free(func_name);
-                        fflush(stdout);
-                        return result;
-                    }
-                    if (stmt->type == AST_BREAK || stmt->type == AST_CONTINUE) break;
-                    stmt = stmt->next;
-                }
-                interpreter_pop_scope(interpreter);
-                free(func_name);
-                fflush(stdout);
-                return result;
-            } else {
-                Value result = interpreter_eval(interpreter, body);
-                Value ret_check = interpreter_get_variable(interpreter, "__return__");
-                if (ret_check.type == VALUE_NUMBER && ret_check.as.number == 1) {
-                    result = interpreter_get_variable(interpreter, "__return_value__");
-                    interpreter_pop_scope(interpreter);
-                    interpreter_set_variable(interpreter, "__return__", ret_check);
-                    interpreter_set_variable(interpreter, "__return_value__", result);
-                    free(func_name);
-                    fflush(stdout);
-                    return result;
-                }
-                interpreter_pop_scope(interpreter);
-                free(func_name);
-                fflush(stdout);
-                return result;
-            }
-        } else {
-            if (node->type == AST_MAIN_CALL) {
-            }
-        }
+        int argc = interpreter_push_args(interpreter, node->left);
+        return interpreter_invoke(interpreter, func_node, argc);
     } else {
         if (node->type == AST_MAIN_CALL) {
             printf("Error: main function not found\n"); 
         } else {
-            printf("Warning: function '%s' not found\n", func_name);
+            printf("Warning: function '%s' not found\n", node->value);
         }
         fflush(stdout);
     }
     
-    free(func_name);
-    Value null_value = {VALUE_NULL, {0}};
-    return null_value;
+    return value_null();
 }
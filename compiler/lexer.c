@@ -2,12 +2,43 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 #include "lexer.h"
 
-Lexer* lexer_create(const char *source) {
+/*
+ * Whitespace, comments and string literals are scanned a vector at a time
+ * where the target supports it. Build with -DTESS_NO_SIMD to force the
+ * scalar loops.
+ */
+#if !defined(TESS_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define LEXER_VECTOR 32
+typedef __m256i LexerVector;
+#define vector_load(p) _mm256_loadu_si256((const __m256i*)(p))
+#define vector_splat(c) _mm256_set1_epi8(c)
+#define vector_eq(a, b) _mm256_cmpeq_epi8(a, b)
+#define vector_or(a, b) _mm256_or_si256(a, b)
+#define vector_mask(v) ((uint32_t)_mm256_movemask_epi8(v))
+#elif !defined(TESS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define LEXER_VECTOR 16
+typedef __m128i LexerVector;
+#define vector_load(p) _mm_loadu_si128((const __m128i*)(p))
+#define vector_splat(c) _mm_set1_epi8(c)
+#define vector_eq(a, b) _mm_cmpeq_epi8(a, b)
+#define vector_or(a, b) _mm_or_si128(a, b)
+#define vector_mask(v) ((uint32_t)_mm_movemask_epi8(v))
+#endif
+
+#ifdef LEXER_VECTOR
+#define LEXER_FULL_MASK ((uint32_t)((1ull << LEXER_VECTOR) - 1))
+#endif
+
+Lexer* lexer_create(const char *source, size_t length, Arena *arena) {
     Lexer *lexer = malloc(sizeof(Lexer));
-    lexer->source = strdup(source);
-    lexer->source_len = strlen(source);
+    lexer->arena = arena;
+    lexer->source = source;
+    lexer->source_len = length;
     lexer->position = 0;
     lexer->line = 1;
     lexer->column = 1;
@@ -19,51 +50,120 @@ Lexer* lexer_create(const char *source) {
 
 void lexer_destroy(Lexer *lexer) {
     if (lexer) {
-        free((void*)lexer->source);
-        if (lexer->tokens) {
-            for (size_t i = 0; i < lexer->token_count; i++) {
-                if (lexer->tokens[i].value) {
-                    free(lexer->tokens[i].value);
-                }
-            }
-            free(lexer->tokens);
-        }
+        free(lexer->tokens);
         free(lexer);
     }
 }
 
+/* Index of the first byte at or after pos that is a or b, or end. */
+static size_t lexer_find(const char *source, size_t pos, size_t end, char a, char b) {
+#ifdef LEXER_VECTOR
+    LexerVector va = vector_splat(a);
+    LexerVector vb = vector_splat(b);
+    while (pos + LEXER_VECTOR <= end) {
+        LexerVector chunk = vector_load(source + pos);
+        uint32_t mask = vector_mask(vector_or(vector_eq(chunk, va), vector_eq(chunk, vb)));
+        if (mask) return pos + __builtin_ctz(mask);
+        pos += LEXER_VECTOR;
+    }
+#endif
+    while (pos < end && source[pos] != a && source[pos] != b) pos++;
+    return pos;
+}
+
+static int lexer_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static size_t lexer_find_nonspace(const char *source, size_t pos, size_t end) {
+#ifdef LEXER_VECTOR
+    LexerVector space = vector_splat(' ');
+    LexerVector tab = vector_splat('\t');
+    LexerVector cr = vector_splat('\r');
+    LexerVector nl = vector_splat('\n');
+    while (pos + LEXER_VECTOR <= end) {
+        LexerVector chunk = vector_load(source + pos);
+        LexerVector blank = vector_or(vector_or(vector_eq(chunk, space), vector_eq(chunk, tab)),
+                                      vector_or(vector_eq(chunk, cr), vector_eq(chunk, nl)));
+        uint32_t mask = ~vector_mask(blank) & LEXER_FULL_MASK;
+        if (mask) return pos + __builtin_ctz(mask);
+        pos += LEXER_VECTOR;
+    }
+#endif
+    while (pos < end && lexer_is_space(source[pos])) pos++;
+    return pos;
+}
+
+/* Moves to target, counting the newlines passed over. */
+static void lexer_advance_to(Lexer *lexer, size_t target) {
+    const char *source = lexer->source;
+    size_t pos = lexer->position;
+    size_t line_start = 0;
+    int lines = 0;
+#ifdef LEXER_VECTOR
+    LexerVector nl = vector_splat('\n');
+    while (pos + LEXER_VECTOR <= target) {
+        uint32_t mask = vector_mask(vector_eq(vector_load(source + pos), nl));
+        if (mask) {
+            lines += __builtin_popcount(mask);
+            line_start = pos + (31 - __builtin_clz(mask)) + 1;
+        }
+        pos += LEXER_VECTOR;
+    }
+#endif
+    for (; pos < target; pos++) {
+        if (source[pos] == '\n') {
+            lines++;
+            line_start = pos + 1;
+        }
+    }
+    if (lines > 0) {
+        lexer->line += lines;
+        lexer->column = (int)(target - line_start) + 1;
+    } else {
+        lexer->column += (int)(target - lexer->position);
+    }
+    lexer->position = target;
+}
+
 void lexer_skip_whitespace(Lexer *lexer) {
+    /* Most runs are a space or two; only long ones are worth a vector scan. */
+    size_t limit = lexer->position + 16;
     while (lexer->position < lexer->source_len) {
         char c = lexer->source[lexer->position];
         if (c == ' ' || c == '\t' || c == '\r') {
-            lexer->position++;
             lexer->column++;
         } else if (c == '\n') {
-            lexer->position++;
             lexer->line++;
             lexer->column = 1;
         } else {
-            break;
+            return;
+        }
+        if (++lexer->position == limit) {
+            lexer_advance_to(lexer, lexer_find_nonspace(lexer->source, lexer->position, lexer->source_len));
+            return;
         }
     }
 }
 
+static void lexer_skip_line(Lexer *lexer) {
+    size_t end = lexer_find(lexer->source, lexer->position, lexer->source_len, '\n', '\n');
+    lexer->column += (int)(end - lexer->position);
+    lexer->position = end;
+    if (lexer->position < lexer->source_len) {
+        lexer->position++;
+        lexer->line++;
+        lexer->column = 1;
+    }
+}
+
 void lexer_skip_comment(Lexer *lexer) {
     if (lexer->position + 1 < lexer->source_len &&
         lexer->source[lexer->position] == '$' &&
         lexer->source[lexer->position + 1] == '$') {
         lexer->position += 2;
         lexer->column += 2;
-        while (lexer->position < lexer->source_len) {
-            if (lexer->source[lexer->position] == '\n') {
-                lexer->line++;
-                lexer->column = 1;
-                lexer->position++;
-                break;
-            }
-            lexer->position++;
-            lexer->column++;
-        }
+        lexer_skip_line(lexer);
         return;
     }
     
@@ -71,17 +171,68 @@ void lexer_skip_comment(Lexer *lexer) {
         lexer->source[lexer->position] == '#') {
         lexer->position++;
         lexer->column++;
-        while (lexer->position < lexer->source_len) {
-            if (lexer->source[lexer->position] == '\n') {
-                lexer->line++;
-                lexer->column = 1;
-                lexer->position++;
-                break;
+        lexer_skip_line(lexer);
+    }
+}
+
+static TessTokenType lexer_match(const char *chars, size_t length, const char *word, TessTokenType type) {
+    return memcmp(chars, word, length) == 0 ? type : TOKEN_IDENTIFIER;
+}
+
+/* Keywords are picked by length, then first byte, so an identifier costs
+ * at most one memcmp. */
+static TessTokenType lexer_keyword(const char *chars, size_t length) {
+    switch (length) {
+        case 2:
+            if (chars[0] == 'i') return lexer_match(chars, length, "if", TOKEN_IF);
+            break;
+        case 3:
+            switch (chars[0]) {
+                case 'a': return lexer_match(chars, length, "add", TOKEN_ADD);
+                case 'c': return lexer_match(chars, length, "cls", TOKEN_CLASS);
+                case 'f': return lexer_match(chars, length, "for", TOKEN_FOR);
+                case 'g': return lexer_match(chars, length, "get", TOKEN_GET);
+                case 'n': return lexer_match(chars, length, "new", TOKEN_NEW);
+                case 'r': return lexer_match(chars, length, "ret", TOKEN_RETURN);
+                case 't': return lexer_match(chars, length, "try", TOKEN_TRY);
             }
-            lexer->position++;
-            lexer->column++;
-        }
+            break;
+        case 4:
+            if (chars[0] == 'e') return lexer_match(chars, length, "else", TOKEN_ELSE);
+            break;
+        case 5:
+            switch (chars[0]) {
+                case 'b': return lexer_match(chars, length, "break", TOKEN_BREAK);
+                case 'c': return lexer_match(chars, length, "catch", TOKEN_CATCH);
+                case 's': return lexer_match(chars, length, "start", TOKEN_START);
+                case 'w': return lexer_match(chars, length, "while", TOKEN_WHILE);
+            }
+            break;
+        case 6:
+            switch (chars[0]) {
+                case 'h': return lexer_match(chars, length, "http::", TOKEN_HTTP);
+                case 'r': return lexer_match(chars, length, "repeat", TOKEN_REPEAT);
+            }
+            break;
+        case 7:
+            if (chars[0] == 'p') return lexer_match(chars, length, "print::", TOKEN_PRINT);
+            break;
+        case 8:
+            if (chars[0] == 'c') return lexer_match(chars, length, "continue", TOKEN_CONTINUE);
+            break;
+        case 9:
+            if (chars[0] == 'r') return lexer_match(chars, length, "request::", TOKEN_REQUEST);
+            break;
     }
+    return TOKEN_IDENTIFIER;
+}
+
+static Token lexer_emit(Lexer *lexer, Token token, TessTokenType type, size_t length) {
+    token.type = type;
+    token.length = length;
+    lexer->position += length;
+    lexer->column += (int)length;
+    return token;
 }
 
 Token lexer_next_token(Lexer *lexer) {
@@ -94,185 +245,99 @@ Token lexer_next_token(Lexer *lexer) {
         }
     }
 
+    Token token;
+    token.start = lexer->position;
+    token.length = 0;
+    token.text = NULL;
+    token.line = lexer->line;
+    token.column = lexer->column;
+
     if (lexer->position >= lexer->source_len) {
-        Token token = {TOKEN_EOF, NULL, lexer->line, lexer->column};
+        token.type = TOKEN_EOF;
         return token;
     }
 
     char c = lexer->source[lexer->position];
-    int start_line = lexer->line;
-    int start_col = lexer->column;
-
-    Token token;
-    token.line = start_line;
-    token.column = start_col;
-    token.value = NULL;
-
-    if (c == '<') {
-        if (lexer->position + 1 < lexer->source_len && lexer->source[lexer->position + 1] == '<') {
-            token.type = TOKEN_LT_LT;
-            token.value = strdup("<<");
-            lexer->position += 2; lexer->column += 2;
-            return token;
-        }
-        if (lexer->position + 1 < lexer->source_len && lexer->source[lexer->position + 1] == '=') {
-            token.type = TOKEN_LTE;
-            token.value = strdup("<=");
-            lexer->position += 2; lexer->column += 2;
-            return token;
-        }
-        token.type = TOKEN_LT;
-        token.value = strdup("<");
-        lexer->position++; lexer->column++;
-        return token;
-    }
+    char next = lexer->position + 1 < lexer->source_len ? lexer->source[lexer->position + 1] : '\0';
 
-    if (c == '>') {
-        if (lexer->position + 1 < lexer->source_len && lexer->source[lexer->position + 1] == '>') {
-            token.type = TOKEN_GT_GT;
-            token.value = strdup(">>");
-            lexer->position += 2; lexer->column += 2;
-            return token;
-        }
-        if (lexer->position + 1 < lexer->source_len && lexer->source[lexer->position + 1] == '=') {
-            token.type = TOKEN_GTE;
-            token.value = strdup(">=");
-            lexer->position += 2; lexer->column += 2;
-            return token;
-        }
-        token.type = TOKEN_GT;
-        token.value = strdup(">");
-        lexer->position++; lexer->column++;
-        return token;
+    switch (c) {
+        case '<':
+            if (next == '<') return lexer_emit(lexer, token, TOKEN_LT_LT, 2);
+            if (next == '=') return lexer_emit(lexer, token, TOKEN_LTE, 2);
+            return lexer_emit(lexer, token, TOKEN_LT, 1);
+        case '>':
+            if (next == '>') return lexer_emit(lexer, token, TOKEN_GT_GT, 2);
+            if (next == '=') return lexer_emit(lexer, token, TOKEN_GTE, 2);
+            return lexer_emit(lexer, token, TOKEN_GT, 1);
+        case '=':
+            if (next == '=') return lexer_emit(lexer, token, TOKEN_EQ, 2);
+            return lexer_emit(lexer, token, TOKEN_ASSIGN, 1);
+        case '!':
+            if (next == '=') return lexer_emit(lexer, token, TOKEN_NEQ, 2);
+            return lexer_emit(lexer, token, TOKEN_EXCLAMATION, 1);
+        case '+': return lexer_emit(lexer, token, TOKEN_PLUS, 1);
+        case '-': return lexer_emit(lexer, token, TOKEN_MINUS, 1);
+        case '*': return lexer_emit(lexer, token, TOKEN_MULTIPLY, 1);
+        case '/': return lexer_emit(lexer, token, TOKEN_DIVIDE, 1);
+        case '%': return lexer_emit(lexer, token, TOKEN_PERCENT, 1);
+        case '(': return lexer_emit(lexer, token, TOKEN_LPAREN, 1);
+        case ')': return lexer_emit(lexer, token, TOKEN_RPAREN, 1);
+        case '{': return lexer_emit(lexer, token, TOKEN_LBRACE, 1);
+        case '}': return lexer_emit(lexer, token, TOKEN_RBRACE, 1);
+        case '[': return lexer_emit(lexer, token, TOKEN_LBRACKET, 1);
+        case ']': return lexer_emit(lexer, token, TOKEN_RBRACKET, 1);
+        case ':': return lexer_emit(lexer, token, TOKEN_COLON, 1);
+        case ';': return lexer_emit(lexer, token, TOKEN_SEMICOLON, 1);
+        case ',': return lexer_emit(lexer, token, TOKEN_COMMA, 1);
+        case '.': return lexer_emit(lexer, token, TOKEN_DOT, 1);
     }
 
-    if (c == '=') {
-        if (lexer->position + 1 < lexer->source_len && lexer->source[lexer->position + 1] == '=') {
-            token.type = TOKEN_EQ;
-            token.value = strdup("==");
-            lexer->position += 2; lexer->column += 2;
-            return token;
-        }
-        token.type = TOKEN_ASSIGN;
-        token.value = strdup("=");
-        lexer->position++; lexer->column++;
-        return token;
-    }
-    
-    if (c == '!') {
-        if (lexer->position + 1 < lexer->source_len && lexer->source[lexer->position + 1] == '=') {
-            token.type = TOKEN_NEQ;
-            token.value = strdup("!=");
-            lexer->position += 2; lexer->column += 2;
-            return token;
-        }
-        token.type = TOKEN_EXCLAMATION;
-        token.value = strdup("!");
-        lexer->position++; lexer->column++;
-        return token;
-    }
+    if (c == '"') {
+        const char *source = lexer->source;
+        size_t source_len = lexer->source_len;
+        size_t start = lexer->position + 1;
+        size_t end = lexer_find(source, start, source_len, '"', '\\');
 
-    switch (c) {
-        case '+': 
-            token.type = TOKEN_PLUS; token.value = strdup("+"); 
-            lexer->position++; lexer->column++; return token;
-        case '-': 
-            token.type = TOKEN_MINUS; token.value = strdup("-"); 
-            lexer->position++; lexer->column++; return token;
-        case '*': 
-            token.type = TOKEN_MULTIPLY; token.value = strdup("*"); 
-            lexer->position++; lexer->column++; return token;
-        case '/': 
-            token.type = TOKEN_DIVIDE; token.value = strdup("/"); 
-            lexer->position++; lexer->column++; return token;
-        case '%': 
-            token.type = TOKEN_PERCENT; token.value = strdup("%"); 
-            lexer->position++; lexer->column++; return token;
-        case '(': 
-            token.type = TOKEN_LPAREN; token.value = strdup("("); 
-            lexer->position++; lexer->column++; return token;
-        case ')': 
-            token.type = TOKEN_RPAREN; token.value = strdup(")"); 
-            lexer->position++; lexer->column++; return token;
-        case '{': 
-            token.type = TOKEN_LBRACE; token.value = strdup("{"); 
-            lexer->position++; lexer->column++; return token;
-        case '}': 
-            token.type = TOKEN_RBRACE; token.value = strdup("}"); 
-            lexer->position++; lexer->column++; return token;
-        case '[': 
-            token.type = TOKEN_LBRACKET; token.value = strdup("["); 
-            lexer->position++; lexer->column++; return token;
-        case ']': 
-            token.type = TOKEN_RBRACKET; token.value = strdup("]"); 
-            lexer->position++; lexer->column++; return token;
-        case ':': 
-            if (lexer->position + 1 < lexer->source_len && lexer->source[lexer->position + 1] == ':') {
-                token.type = TOKEN_COLON; token.value = strdup(":"); 
-                lexer->position++; lexer->column++; return token;
+        token.type = TOKEN_STRING;
+        if (end == source_len || source[end] == '"') {
+            token.start = start;
+            token.length = end - start;
+        } else {
+            /* Find the closing quote first so the decoded text can be sized. */
+            while (end < source_len && source[end] == '\\') {
+                end = end + 2 >= source_len ? source_len : lexer_find(source, end + 2, source_len, '"', '\\');
             }
-            token.type = TOKEN_COLON; token.value = strdup(":"); 
-            lexer->position++; lexer->column++; return token;
-        case ';': 
-            token.type = TOKEN_SEMICOLON; token.value = strdup(";"); 
-            lexer->position++; lexer->column++; return token;
-        case ',': 
-            token.type = TOKEN_COMMA; token.value = strdup(","); 
-            lexer->position++; lexer->column++; return token;
-        case '.': 
-            token.type = TOKEN_DOT; token.value = strdup("."); 
-            lexer->position++; lexer->column++; return token;
-    }
 
-    if (c == '"') {
-        lexer->position++;
-        lexer->column++;
-        size_t str_len = 0;
-        char *str = malloc(1024);
-        if (!str) {
-            token.type = TOKEN_EOF;
-            return token;
-        }
-        
-        while (lexer->position < lexer->source_len) {
-            if (lexer->source[lexer->position] == '\\' && 
-                lexer->position + 1 < lexer->source_len) {
-                lexer->position++;
-                char esc = lexer->source[lexer->position];
-                switch (esc) {
+            char *str = arena_alloc(lexer->arena, end - start + 1);
+            size_t str_len = 0;
+            size_t pos = start;
+            while (pos < end) {
+                size_t next = lexer_find(source, pos, end, '\\', '\\');
+                memcpy(str + str_len, source + pos, next - pos);
+                str_len += next - pos;
+                if (next == end) break;
+                if (next + 1 >= source_len) {
+                    str[str_len++] = '\\';
+                    break;
+                }
+                switch (source[next + 1]) {
                     case 'n': str[str_len++] = '\n'; break;
                     case 't': str[str_len++] = '\t'; break;
                     case 'r': str[str_len++] = '\r'; break;
-                    case '\\': str[str_len++] = '\\'; break;
-                    case '"': str[str_len++] = '"'; break;
-                    default: str[str_len++] = esc; break;
+                    default: str[str_len++] = source[next + 1]; break;
                 }
-                lexer->position++;
-                lexer->column += 2;
-            } else if (lexer->source[lexer->position] == '"') {
-                lexer->position++;
-                lexer->column++;
-                break;
-            } else {
-                if (lexer->source[lexer->position] == '\n') {
-                    lexer->line++;
-                    lexer->column = 1;
-                } else {
-                    lexer->column++;
-                }
-                str[str_len++] = lexer->source[lexer->position++];
-            }
-            
-            if (str_len >= 1023) {
-                char *new_str = realloc(str, str_len + 1024);
-                if (!new_str) break;
-                str = new_str;
+                pos = next + 2;
             }
+            str[str_len] = '\0';
+            token.text = str;
+            token.length = str_len;
+        }
+
+        lexer_advance_to(lexer, end);
+        if (lexer->position < source_len) {
+            lexer->position++;
+            lexer->column++;
         }
-        
-        str[str_len] = '\0';
-        token.type = TOKEN_STRING;
-        token.value = str;
         return token;
     }
 
@@ -284,12 +349,8 @@ Token lexer_next_token(Lexer *lexer) {
             lexer->position++;
             lexer->column++;
         }
-        size_t len = lexer->position - start;
-        char *num = malloc(len + 1);
-        memcpy(num, lexer->source + start, len);
-        num[len] = '\0';
         token.type = TOKEN_NUMBER;
-        token.value = num;
+        token.length = lexer->position - start;
         return token;
     }
 
@@ -303,39 +364,17 @@ Token lexer_next_token(Lexer *lexer) {
             lexer->column++;
         }
         size_t len = lexer->position - start;
-        char *ident = malloc(len + 1);
-        memcpy(ident, lexer->source + start, len);
-        ident[len] = '\0';
+        const char *ident = lexer->source + start;
 
-        token.value = ident;
+        token.length = len;
         token.type = TOKEN_IDENTIFIER;
 
-        if (strcmp(ident, "if") == 0) token.type = TOKEN_IF;
-        else if (strcmp(ident, "else") == 0) token.type = TOKEN_ELSE;
-        else if (strcmp(ident, "while") == 0) token.type = TOKEN_WHILE;
-        else if (strcmp(ident, "repeat") == 0) token.type = TOKEN_REPEAT;
-        else if (strcmp(ident, "for") == 0) token.type = TOKEN_FOR;
-        else if (strcmp(ident, "break") == 0) token.type = TOKEN_BREAK;
-        else if (strcmp(ident, "continue") == 0) token.type = TOKEN_CONTINUE;
-        else if (strcmp(ident, "ret") == 0) token.type = TOKEN_RETURN;
-        else if (strcmp(ident, "cls") == 0) token.type = TOKEN_CLASS;
-        else if (strcmp(ident, "new") == 0) token.type = TOKEN_NEW;
-        else if (strcmp(ident, "try") == 0) token.type = TOKEN_TRY;
-        else if (strcmp(ident, "catch") == 0) token.type = TOKEN_CATCH;
-        else if (strcmp(ident, "print::") == 0) token.type = TOKEN_PRINT;
-        else if (strcmp(ident, "request::") == 0) token.type = TOKEN_REQUEST;
-        else if (strcmp(ident, "http::") == 0) token.type = TOKEN_HTTP;
-        else if (strcmp(ident, "start") == 0) token.type = TOKEN_START;
-        else if (strcmp(ident, "get") == 0) token.type = TOKEN_GET;
-        else if (strcmp(ident, "add") == 0) token.type = TOKEN_ADD;
+        token.type = lexer_keyword(ident, len);
 
         return token;
     }
 
-    lexer->position++;
-    lexer->column++;
-    token.type = TOKEN_EOF;
-    return token;
+    return lexer_emit(lexer, token, TOKEN_EOF, 1);
 }
 
 void lexer_tokenize(Lexer *lexer) {
@@ -356,3 +395,7 @@ void lexer_tokenize(Lexer *lexer) {
         if (token.type == TOKEN_EOF) break;
     }
 }
+
+const char* lexer_token_chars(Lexer *lexer, Token token) {
+    return token.text ? token.text : lexer->source + token.start;
+}
@@ -5,6 +5,46 @@
 
 int main_tess(int argc, char *argv[]) {
     setbuf(stdout, NULL);
+
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--engine=", 9) == 0) {
+            if (tess_set_engine(argv[i] + 9) != 0) {
+                fprintf(stderr, "Error: Unknown engine '%s' (expected 'vm' or 'ast')\n", argv[i] + 9);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--no-cache") == 0) {
+            tess_set_cache(0);
+            continue;
+        }
+        if (strncmp(argv[i], "--gc-growth=", 12) == 0) {
+            if (tess_set_gc_growth(argv[i] + 12) != 0) {
+                fprintf(stderr, "Error: Invalid GC growth factor '%s' (expected a number above 1)\n", argv[i] + 12);
+                return 1;
+            }
+            continue;
+        }
+        if (strncmp(argv[i], "--max-depth=", 12) == 0) {
+            if (tess_set_max_depth(argv[i] + 12) != 0) {
+                fprintf(stderr, "Error: Invalid maximum call depth '%s' (expected a positive integer)\n", argv[i] + 12);
+                return 1;
+            }
+            continue;
+        }
+        if (strcmp(argv[i], "--trace-imports") == 0) {
+            tess_set_trace_imports(1);
+            continue;
+        }
+        if (strcmp(argv[i], "--ic-stats") == 0) {
+            tess_set_ic_stats(1);
+            continue;
+        }
+        argv[kept++] = argv[i];
+    }
+    argc = kept;
+
     if (argc < 2) {
         printf("Tess Language Compiler/Interpreter\n");
         printf("Usage: tess <command> [arguments]\n");
@@ -25,6 +65,14 @@ int main_tess(int argc, char *argv[]) {
         printf("  check <file>  - Syntax check only (Python py_compile style)\n");
         printf("  venv <dir>    - Create virtual environment (Python -m venv style)\n");
         printf("  test          - Run tests (pytest equivalent)\n");
+        printf("\nOptions:\n");
+        printf("  --engine=vm   - Execute through the bytecode VM (default)\n");
+        printf("  --engine=ast  - Execute through the AST interpreter\n");
+        printf("  --no-cache    - Always parse sources, ignoring .tessc caches\n");
+        printf("  --trace-imports - Report where each module resolved and how long it took\n");
+        printf("  --ic-stats    - Report inline cache hits and misses per member access site\n");
+        printf("  --gc-growth=<factor> - Heap growth allowed between collections (default 2)\n");
+        printf("  --max-depth=<n> - Deepest call nesting before a stack overflow error (default 10000)\n");
         printf("\nNote: 'ts' can be used as alias for 'tess'\n");
         return 1;
     }
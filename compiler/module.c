@@ -1,109 +1,394 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
+#include <time.h>
 #ifdef _WIN32
-#include <direct.h>
-#include <io.h>
-#define access _access
-#define F_OK 0
+#include <windows.h>
 #else
-#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #endif
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "resolver.h"
+#include "module_cache.h"
+#include "tess_alloc.h"
 
 #define MODULE_EXT ".tess"
 #define PACKAGE_DIR ".tess_packages"
 #define SAINT_DIR "SAINT"
 
-static char* find_module_file(const char *module_name) {
-    static char path[1024];
-    
-    snprintf(path, sizeof(path), "%s%s", module_name, MODULE_EXT);
-    if (access(path, F_OK) == 0) {
-        return path;
+static int trace_imports = 0;
+
+void module_set_trace(int enabled) {
+    trace_imports = enabled;
+}
+
+static double module_now(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+static unsigned long module_hash(const char *name) {
+    unsigned long hash = 5381;
+    int c;
+    while ((c = *name++)) hash = ((hash << 5) + hash) + c;
+    return hash;
+}
+
+/* The .tess files in one search directory, listed the first time an
+ * import looks there and again when a lookup misses. A directory that
+ * does not exist has no entries. */
+typedef struct ModuleDir {
+    char *path;
+    char **entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    struct ModuleDir *next;
+} ModuleDir;
+
+static void dir_clear(ModuleDir *dir);
+
+typedef enum {
+    MODULE_NEW,
+    MODULE_LOADING,
+    MODULE_LOADED,
+    MODULE_FAILED
+} ModuleState;
+
+typedef struct {
+    char *path;
+    ModuleState state;
+    Proto *proto;
+} Module;
+
+typedef struct {
+    char *name;
+    Module *module;
+} ModuleName;
+
+struct ModuleRegistry {
+    Arena *arena;
+    Module **modules;
+    size_t module_count;
+    size_t module_capacity;
+    ModuleName *names;
+    size_t name_count;
+    size_t name_capacity;
+    ModuleDir *dirs;
+};
+
+ModuleRegistry* module_registry_create(void) {
+    ModuleRegistry *registry = calloc(1, sizeof(ModuleRegistry));
+    registry->arena = arena_create();
+    return registry;
+}
+
+void module_registry_destroy(ModuleRegistry *registry) {
+    if (!registry) return;
+    for (size_t i = 0; i < registry->module_count; i++) {
+        bytecode_destroy(registry->modules[i]->proto);
+        free(registry->modules[i]->path);
+        free(registry->modules[i]);
     }
-    
-    snprintf(path, sizeof(path), "%s/%s%s", SAINT_DIR, module_name, MODULE_EXT);
-    if (access(path, F_OK) == 0) {
-        return path;
+    for (size_t i = 0; i < registry->name_capacity; i++) {
+        free(registry->names[i].name);
     }
-    
-    snprintf(path, sizeof(path), "%s/%s/%s%s", SAINT_DIR, module_name, module_name, MODULE_EXT);
-    if (access(path, F_OK) == 0) {
-        return path;
+    while (registry->dirs) {
+        ModuleDir *dir = registry->dirs;
+        registry->dirs = dir->next;
+        dir_clear(dir);
+        free(dir->path);
+        free(dir);
     }
-    
-    char *slash = strchr(module_name, '/');
-    if (slash) {
-        snprintf(path, sizeof(path), "%s/%s%s", SAINT_DIR, module_name, MODULE_EXT);
-        if (access(path, F_OK) == 0) {
-            return path;
+    free(registry->modules);
+    free(registry->names);
+    arena_destroy(registry->arena);
+    free(registry);
+}
+
+static ModuleName* registry_slot(ModuleName *names, size_t capacity, const char *name) {
+    size_t mask = capacity - 1;
+    size_t i = module_hash(name) & mask;
+    while (names[i].name && strcmp(names[i].name, name) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &names[i];
+}
+
+static Module* registry_find(ModuleRegistry *registry, const char *name) {
+    if (registry->name_capacity == 0) return NULL;
+    return registry_slot(registry->names, registry->name_capacity, name)->module;
+}
+
+static void registry_bind(ModuleRegistry *registry, const char *name, Module *module) {
+    if ((registry->name_count + 1) * 2 > registry->name_capacity) {
+        size_t new_capacity = registry->name_capacity == 0 ? 16 : registry->name_capacity * 2;
+        ModuleName *names = calloc(new_capacity, sizeof(ModuleName));
+        for (size_t i = 0; i < registry->name_capacity; i++) {
+            if (registry->names[i].name) {
+                *registry_slot(names, new_capacity, registry->names[i].name) = registry->names[i];
+            }
         }
+        free(registry->names);
+        registry->names = names;
+        registry->name_capacity = new_capacity;
     }
-    
-    snprintf(path, sizeof(path), "%s/%s%s", PACKAGE_DIR, module_name, MODULE_EXT);
-    if (access(path, F_OK) == 0) {
-        return path;
+    ModuleName *slot = registry_slot(registry->names, registry->name_capacity, name);
+    slot->name = tess_strdup(name);
+    slot->module = module;
+    registry->name_count++;
+}
+
+/* Different import names can resolve to the same file; they share one
+ * module. Only the first import of each name gets here. */
+static Module* registry_module(ModuleRegistry *registry, const char *path) {
+    for (size_t i = 0; i < registry->module_count; i++) {
+        if (strcmp(registry->modules[i]->path, path) == 0) {
+            return registry->modules[i];
+        }
     }
-    
-    return NULL;
+    if (registry->module_count >= registry->module_capacity) {
+        registry->module_capacity = registry->module_capacity == 0 ? 8 : registry->module_capacity * 2;
+        registry->modules = realloc(registry->modules, sizeof(Module*) * registry->module_capacity);
+    }
+    Module *module = calloc(1, sizeof(Module));
+    module->path = tess_strdup(path);
+    module->state = MODULE_NEW;
+    registry->modules[registry->module_count++] = module;
+    return module;
 }
 
-ASTNode* module_load(const char *module_name) {
-    char *module_file = find_module_file(module_name);
-    if (!module_file) {
-        fprintf(stderr, "Error: Module '%s' not found\n", module_name);
-        return NULL;
+static int module_is_file(const char *path) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat info;
+    return stat(path, &info) == 0 && S_ISREG(info.st_mode);
+#endif
+}
+
+static char** dir_slot(char **entries, size_t capacity, const char *name) {
+    size_t mask = capacity - 1;
+    size_t i = module_hash(name) & mask;
+    while (entries[i] && strcmp(entries[i], name) != 0) {
+        i = (i + 1) & mask;
     }
-    
-    FILE *file = fopen(module_file, "r");
-    if (!file) {
-        fprintf(stderr, "Error: Cannot open module file '%s'\n", module_file);
-        return NULL;
+    return &entries[i];
+}
+
+static int dir_is_module(const char *name) {
+    size_t length = strlen(name);
+    size_t ext_length = strlen(MODULE_EXT);
+    return length > ext_length && strcmp(name + length - ext_length, MODULE_EXT) == 0;
+}
+
+static void dir_add(ModuleDir *dir, const char *name) {
+    if ((dir->entry_count + 1) * 2 > dir->entry_capacity) {
+        size_t new_capacity = dir->entry_capacity == 0 ? 16 : dir->entry_capacity * 2;
+        char **entries = calloc(new_capacity, sizeof(char*));
+        for (size_t i = 0; i < dir->entry_capacity; i++) {
+            if (dir->entries[i]) {
+                *dir_slot(entries, new_capacity, dir->entries[i]) = dir->entries[i];
+            }
+        }
+        free(dir->entries);
+        dir->entries = entries;
+        dir->entry_capacity = new_capacity;
     }
-    
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    char *source = malloc(file_size + 1);
-    fread(source, 1, file_size, file);
-    source[file_size] = '\0';
-    fclose(file);
-    
-    Lexer *lexer = lexer_create(source);
-    lexer_tokenize(lexer);
-    
-    if (!lexer->tokens || lexer->token_count == 0) {
-        fprintf(stderr, "Error: Failed to tokenize module '%s'\n", module_name);
-        free(source);
-        lexer_destroy(lexer);
-        return NULL;
+    *dir_slot(dir->entries, dir->entry_capacity, name) = tess_strdup(name);
+    dir->entry_count++;
+}
+
+static void dir_scan(ModuleDir *dir) {
+#ifdef _WIN32
+    char pattern[1024];
+    snprintf(pattern, sizeof(pattern), "%s\\*", dir->path);
+    WIN32_FIND_DATAA entry;
+    HANDLE handle = FindFirstFileA(pattern, &entry);
+    if (handle == INVALID_HANDLE_VALUE) return;
+    do {
+        if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && dir_is_module(entry.cFileName)) {
+            dir_add(dir, entry.cFileName);
+        }
+    } while (FindNextFileA(handle, &entry));
+    FindClose(handle);
+#else
+    DIR *handle = opendir(dir->path);
+    if (!handle) return;
+    struct dirent *entry;
+    char file[1024];
+    while ((entry = readdir(handle)) != NULL) {
+        if (!dir_is_module(entry->d_name)) continue;
+        snprintf(file, sizeof(file), "%s/%s", dir->path, entry->d_name);
+        if (module_is_file(file)) {
+            dir_add(dir, entry->d_name);
+        }
     }
-    
-    Parser *parser = parser_create(lexer);
-    ASTNode *ast = parser_parse(parser);
-    
-    free(source);
-    lexer_destroy(lexer);
-    parser_destroy(parser);
-    
-    return ast;
+    closedir(handle);
+#endif
 }
 
-void module_execute(Interpreter *interpreter, ASTNode *module_ast) {
+static void dir_clear(ModuleDir *dir) {
+    for (size_t i = 0; i < dir->entry_capacity; i++) {
+        free(dir->entries[i]);
+    }
+    free(dir->entries);
+    dir->entries = NULL;
+    dir->entry_count = 0;
+    dir->entry_capacity = 0;
+}
+
+static ModuleDir* registry_dir(ModuleRegistry *registry, const char *path) {
+    for (ModuleDir *dir = registry->dirs; dir; dir = dir->next) {
+        if (strcmp(dir->path, path) == 0) return dir;
+    }
+    ModuleDir *dir = calloc(1, sizeof(ModuleDir));
+    dir->path = tess_strdup(path);
+    dir_scan(dir);
+    dir->next = registry->dirs;
+    registry->dirs = dir;
+    return dir;
+}
+
+/* Looks the file part of path up in its directory's listing. With
+ * refresh the directory is listed again first, and a name the listing
+ * still lacks is checked on disk, since a case-insensitive filesystem
+ * can open a file under a name that differs from its listed one. */
+static int registry_has_file(ModuleRegistry *registry, const char *path, int refresh) {
+    char dir_path[1024];
+    const char *slash = strrchr(path, '/');
+    const char *name = slash ? slash + 1 : path;
+    if (slash == path) {
+        strcpy(dir_path, "/");
+    } else if (slash) {
+        snprintf(dir_path, sizeof(dir_path), "%.*s", (int)(slash - path), path);
+    } else {
+        strcpy(dir_path, ".");
+    }
+    ModuleDir *dir = registry_dir(registry, dir_path);
+    if (refresh) {
+        dir_clear(dir);
+        dir_scan(dir);
+    }
+    if (dir->entry_capacity > 0 && *dir_slot(dir->entries, dir->entry_capacity, name) != NULL) {
+        return 1;
+    }
+    return refresh && module_is_file(path);
+}
+
+static int module_candidate(const char *module_name, int index, char *path, size_t size) {
+    switch (index) {
+        case 0:
+            snprintf(path, size, "%s%s", module_name, MODULE_EXT);
+            return 1;
+        case 1:
+            snprintf(path, size, "%s/%s%s", SAINT_DIR, module_name, MODULE_EXT);
+            return 1;
+        case 2:
+            snprintf(path, size, "%s/%s/%s%s", SAINT_DIR, module_name, module_name, MODULE_EXT);
+            return 1;
+        case 3:
+            snprintf(path, size, "%s/%s%s", PACKAGE_DIR, module_name, MODULE_EXT);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Tries the cached listings first; only when every candidate misses are
+ * the directories listed again, so modules created since are found. */
+static int find_module_file(ModuleRegistry *registry, const char *module_name, char *path, size_t size) {
+    for (int refresh = 0; refresh <= 1; refresh++) {
+        for (int i = 0; module_candidate(module_name, i, path, size); i++) {
+            if (registry_has_file(registry, path, refresh)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static Proto* module_execute(Interpreter *interpreter, ASTNode *module_ast) {
     if (!module_ast || module_ast->type != AST_PROGRAM) {
-        return;
+        return NULL;
     }
     
-    interpreter_push_scope(interpreter);
+    resolver_resolve(interpreter, module_ast);
+    
+    if (interpreter->engine == ENGINE_VM) {
+        Proto *proto = bytecode_compile(module_ast);
+        vm_execute(interpreter, proto);
+        return proto;
+    }
     
     ASTNode *stmt = module_ast->children;
-    while (stmt) {
+    while (stmt && interpreter->completion == COMPLETION_NORMAL) {
         interpreter_eval(interpreter, stmt);
         stmt = stmt->next;
     }
+    interpreter->completion = COMPLETION_NORMAL;
+    return NULL;
+}
+
+void module_import(Interpreter *interpreter, const char *module_name) {
+    ModuleRegistry *registry = interpreter->modules;
+    Module *module = registry_find(registry, module_name);
+    double resolve_time = 0;
+    if (!module) {
+        char module_file[1024];
+        double start = module_now();
+        int found = find_module_file(registry, module_name, module_file, sizeof(module_file));
+        resolve_time = module_now() - start;
+        if (!found) {
+            if (trace_imports) {
+                fprintf(stderr, "[import] %s: not found (resolve %.1f us)\n", module_name, resolve_time * 1e6);
+            }
+            fprintf(stderr, "Error: Module '%s' not found\n", module_name);
+            return;
+        }
+        module = registry_module(registry, module_file);
+        registry_bind(registry, module_name, module);
+        if (trace_imports && module->state != MODULE_NEW) {
+            fprintf(stderr, "[import] %s: %s (resolve %.1f us, already loaded)\n",
+                    module_name, module->path, resolve_time * 1e6);
+        }
+    }
+    
+    /* A module that is still loading is being imported from its own
+     * import chain; its definitions so far are already visible. */
+    if (module->state != MODULE_NEW) {
+        return;
+    }
+    
+    module->state = MODULE_LOADING;
+    double start = module_now();
+    ASTNode *ast = module_cache_parse(module->path, registry->arena);
+    if (!ast) {
+        fprintf(stderr, "Error: Cannot open module file '%s'\n", module->path);
+        module->state = MODULE_FAILED;
+        return;
+    }
+    double parse_time = module_now() - start;
+    if (trace_imports) {
+        fprintf(stderr, "[import] %s: %s (resolve %.1f us, parse %.1f us)\n",
+                module_name, module->path, resolve_time * 1e6, parse_time * 1e6);
+    }
+    module->proto = module_execute(interpreter, ast);
+    module->state = MODULE_LOADED;
 }
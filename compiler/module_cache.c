@@ -0,0 +1,460 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+#include "module_cache.h"
+#include "source.h"
+
+/* Bump when the parser builds different trees from the same source.
+ * Changes to the node layout or the node and operator enums alter the
+ * version by themselves through cache_version. */
+#define MODULE_CACHE_FORMAT 4
+#define MODULE_CACHE_MAGIC "TESSC\r\n\032"
+#define NO_INDEX 0
+#define AST_TYPE_COUNT (AST_START + 1)
+#define BINOP_COUNT (BINOP_LTE + 1)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t node_count;
+    uint64_t source_hash;
+    uint64_t source_length;
+    int64_t source_mtime;
+    uint64_t node_bytes;
+    uint64_t string_bytes;
+    uint64_t body_hash;
+} CacheHeader;
+
+/*
+ * Nodes are stored children first, so the program node is the last one,
+ * each as a type byte and a byte of NODE_* flags saying which fields
+ * follow. Links are varints counting back from the node they belong to,
+ * value is a varint 1-based offset into the string table, and line and
+ * column are zigzag varints, line relative to the node before. Absent
+ * fields are NULL or zero.
+ */
+#define NODE_LEFT 0x01
+#define NODE_RIGHT 0x02
+#define NODE_CHILDREN 0x04
+#define NODE_NEXT 0x08
+#define NODE_VALUE 0x10
+#define NODE_NUMBER 0x20
+#define NODE_OP 0x40
+#define NODE_CALL 0x80
+#define NODE_MIN_BYTES 4
+#define NODE_MAX_BYTES 64
+
+typedef struct {
+    unsigned char *bytes;
+    size_t byte_count;
+    size_t byte_capacity;
+    uint32_t node_count;
+    int line;
+    char *strings;
+    size_t string_bytes;
+    size_t string_capacity;
+    uint32_t *string_slots;
+    size_t string_count;
+    size_t string_slot_capacity;
+    ASTNode **siblings;
+    size_t sibling_count;
+    size_t sibling_capacity;
+} CacheWriter;
+
+static int cache_enabled = 1;
+
+void module_cache_set_enabled(int enabled) {
+    cache_enabled = enabled;
+}
+
+#define CACHE_HASH_SEED 14695981039346656037ULL
+#define CACHE_HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/* Mixes eight bytes per step; it only has to catch damaged files, not
+ * resist crafted ones. */
+static uint64_t cache_hash_update(uint64_t hash, const void *bytes, size_t length) {
+    const unsigned char *data = bytes;
+    uint64_t word;
+    while (length >= sizeof(word)) {
+        memcpy(&word, data, sizeof(word));
+        hash = (hash ^ word) * CACHE_HASH_MULTIPLIER;
+        hash ^= hash >> 32;
+        data += sizeof(word);
+        length -= sizeof(word);
+    }
+    word = 0;
+    memcpy(&word, data, length);
+    hash = (hash ^ word ^ length) * CACHE_HASH_MULTIPLIER;
+    return hash ^ (hash >> 32);
+}
+
+static uint64_t cache_hash(const char *data, size_t length) {
+    return cache_hash_update(CACHE_HASH_SEED, data, length);
+}
+
+static uint32_t cache_version(void) {
+    uint32_t layout[] = {
+        MODULE_CACHE_FORMAT,
+        (uint32_t)sizeof(ASTNode),
+        AST_TYPE_COUNT,
+        BINOP_COUNT
+    };
+    uint64_t hash = cache_hash_update(CACHE_HASH_SEED, layout, sizeof(layout));
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static uint64_t cache_body_hash(const unsigned char *nodes, size_t node_bytes, const char *strings, size_t string_bytes) {
+    uint64_t hash = cache_hash_update(CACHE_HASH_SEED, nodes, node_bytes);
+    return cache_hash_update(hash, strings, string_bytes);
+}
+
+static char* cache_path(const char *path) {
+    size_t length = strlen(path);
+    char *cache = malloc(length + 2);
+    memcpy(cache, path, length);
+    cache[length] = 'c';
+    cache[length + 1] = '\0';
+    return cache;
+}
+
+static uint32_t* writer_string_slot(uint32_t *slots, size_t capacity, const char *strings, const char *str, size_t length) {
+    size_t mask = capacity - 1;
+    size_t i = cache_hash(str, length) & mask;
+    while (slots[i] && strcmp(strings + slots[i] - 1, str) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+/* Each distinct string is stored once, however many nodes use it. */
+static uint32_t writer_string(CacheWriter *w, const char *str) {
+    if (!str) return NO_INDEX;
+    size_t length = strlen(str) + 1;
+    if ((w->string_count + 1) * 2 > w->string_slot_capacity) {
+        size_t capacity = w->string_slot_capacity == 0 ? 256 : w->string_slot_capacity * 2;
+        uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+        for (size_t i = 0; i < w->string_slot_capacity; i++) {
+            if (w->string_slots[i]) {
+                const char *old = w->strings + w->string_slots[i] - 1;
+                *writer_string_slot(slots, capacity, w->strings, old, strlen(old) + 1) = w->string_slots[i];
+            }
+        }
+        free(w->string_slots);
+        w->string_slots = slots;
+        w->string_slot_capacity = capacity;
+    }
+
+    uint32_t *slot = writer_string_slot(w->string_slots, w->string_slot_capacity, w->strings, str, length);
+    if (*slot) return *slot;
+
+    while (w->string_bytes + length > w->string_capacity) {
+        w->string_capacity = w->string_capacity == 0 ? 4096 : w->string_capacity * 2;
+        w->strings = realloc(w->strings, w->string_capacity);
+    }
+    memcpy(w->strings + w->string_bytes, str, length);
+    w->string_bytes += length;
+    w->string_count++;
+    *slot = (uint32_t)(w->string_bytes - length + 1);
+    return *slot;
+}
+
+static void writer_varint(CacheWriter *w, uint64_t value) {
+    while (value >= 0x80) {
+        w->bytes[w->byte_count++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    w->bytes[w->byte_count++] = (unsigned char)value;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static uint32_t writer_list(CacheWriter *w, ASTNode *first);
+
+static uint32_t writer_node(CacheWriter *w, ASTNode *node, uint32_t next) {
+    uint32_t left = writer_list(w, node->left);
+    uint32_t right = writer_list(w, node->right);
+    uint32_t children = writer_list(w, node->children);
+    uint32_t value = writer_string(w, node->value);
+    uint32_t index = w->node_count + 1;
+    static const double zero = 0;
+
+    unsigned char flags = 0;
+    if (left) flags |= NODE_LEFT;
+    if (right) flags |= NODE_RIGHT;
+    if (children) flags |= NODE_CHILDREN;
+    if (next) flags |= NODE_NEXT;
+    if (value) flags |= NODE_VALUE;
+    if (memcmp(&node->number, &zero, sizeof(zero)) != 0) flags |= NODE_NUMBER;
+    if (node->op != 0) flags |= NODE_OP;
+    if (node->call) flags |= NODE_CALL;
+
+    if (w->byte_count + NODE_MAX_BYTES > w->byte_capacity) {
+        w->byte_capacity = w->byte_capacity == 0 ? 4096 : w->byte_capacity * 2;
+        w->bytes = realloc(w->bytes, w->byte_capacity);
+    }
+    w->bytes[w->byte_count++] = (unsigned char)node->type;
+    w->bytes[w->byte_count++] = flags;
+    if (left) writer_varint(w, index - left);
+    if (right) writer_varint(w, index - right);
+    if (children) writer_varint(w, index - children);
+    if (next) writer_varint(w, index - next);
+    if (value) writer_varint(w, value);
+    if (flags & NODE_OP) w->bytes[w->byte_count++] = (unsigned char)node->op;
+    if (flags & NODE_NUMBER) {
+        memcpy(w->bytes + w->byte_count, &node->number, sizeof(double));
+        w->byte_count += sizeof(double);
+    }
+    writer_varint(w, zigzag((int64_t)node->line - w->line));
+    writer_varint(w, zigzag(node->column));
+    w->line = node->line;
+    w->node_count++;
+    return index;
+}
+
+/* Siblings are written last to first so each one knows its next index
+ * without recursing down the chain. Every list shares one scratch stack;
+ * nested lists push above the current one and are gone before it pops. */
+static uint32_t writer_list(CacheWriter *w, ASTNode *first) {
+    size_t base = w->sibling_count;
+    for (ASTNode *node = first; node; node = node->next) {
+        if (w->sibling_count >= w->sibling_capacity) {
+            w->sibling_capacity = w->sibling_capacity == 0 ? 256 : w->sibling_capacity * 2;
+            w->siblings = realloc(w->siblings, sizeof(ASTNode*) * w->sibling_capacity);
+        }
+        w->siblings[w->sibling_count++] = node;
+    }
+
+    uint32_t next = NO_INDEX;
+    while (w->sibling_count > base) {
+        next = writer_node(w, w->siblings[--w->sibling_count], next);
+    }
+    return next;
+}
+
+/* Within this many seconds of now, the source could change again without its
+ * whole-second mtime moving. */
+#define CACHE_MTIME_SLACK 2
+
+static void cache_store(const char *path, const SourceFile *source, ASTNode *program) {
+    CacheWriter w;
+    memset(&w, 0, sizeof(w));
+    writer_node(&w, program, NO_INDEX);
+
+    CacheHeader header;
+    memcpy(header.magic, MODULE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = cache_version();
+    header.node_count = w.node_count;
+    header.source_hash = cache_hash(source->data, source->length);
+    header.source_length = source->length;
+    /* An mtime of 0 makes every load compare content instead. */
+    header.source_mtime = source->mtime + CACHE_MTIME_SLACK > (int64_t)time(NULL) ? 0 : source->mtime;
+    header.node_bytes = w.byte_count;
+    header.string_bytes = w.string_bytes;
+    header.body_hash = cache_body_hash(w.bytes, w.byte_count, w.strings, w.string_bytes);
+
+    /* Write beside the cache and rename, so a reader never sees half a
+     * file. The temp name carries the pid so processes starting on the
+     * same script never write into each other's file. */
+    char *cache = cache_path(path);
+    size_t length = strlen(cache) + 32;
+    char *temp = malloc(length);
+    snprintf(temp, length, "%s.%ld.tmp", cache, (long)getpid());
+
+    FILE *file = fopen(temp, "wb");
+    if (file) {
+        int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(w.bytes, 1, w.byte_count, file) == w.byte_count &&
+                 fwrite(w.strings, 1, w.string_bytes, file) == w.string_bytes;
+        ok = fclose(file) == 0 && ok;
+#ifdef _WIN32
+        if (ok) remove(cache);
+#endif
+        if (!ok || rename(temp, cache) != 0) {
+            remove(temp);
+        }
+    }
+
+    free(temp);
+    free(cache);
+    free(w.bytes);
+    free(w.strings);
+    free(w.string_slots);
+    free(w.siblings);
+}
+
+static int reader_varint(const unsigned char **at, const unsigned char *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*at >= end) return 0;
+        unsigned char byte = *(*at)++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/* The source matches the cache when its length and mtime are the ones
+ * recorded; the content is hashed only when the mtime differs or was too
+ * recent to trust. */
+static ASTNode* cache_load(const char *path, const SourceFile *source, Arena *arena) {
+    char *cache = cache_path(path);
+    SourceFile file;
+    int status = source_open(&file, cache);
+    free(cache);
+    if (status != 0) return NULL;
+
+    const CacheHeader *header = (const CacheHeader*)file.data;
+    if (file.length < sizeof(CacheHeader) ||
+        memcmp(header->magic, MODULE_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != cache_version() ||
+        header->source_length != source->length ||
+        header->node_count == 0 ||
+        header->node_bytes > file.length || header->string_bytes > file.length ||
+        header->node_count > header->node_bytes / NODE_MIN_BYTES ||
+        file.length != sizeof(CacheHeader) + header->node_bytes + header->string_bytes ||
+        ((header->source_mtime == 0 || header->source_mtime != source->mtime) &&
+         header->source_hash != cache_hash(source->data, source->length))) {
+        source_close(&file);
+        return NULL;
+    }
+
+    uint32_t count = header->node_count;
+    const unsigned char *at = (const unsigned char*)file.data + sizeof(CacheHeader);
+    const unsigned char *end = at + header->node_bytes;
+    const char *table = (const char*)end;
+    size_t string_bytes = header->string_bytes;
+    if (cache_body_hash(at, header->node_bytes, table, string_bytes) != header->body_hash ||
+        (string_bytes > 0 && table[string_bytes - 1] != '\0')) {
+        source_close(&file);
+        return NULL;
+    }
+
+    char *strings = arena_alloc(arena, string_bytes + 1);
+    memcpy(strings, table, string_bytes);
+    ASTNode *nodes = arena_alloc(arena, sizeof(ASTNode) * count);
+    ASTNode *program = NULL;
+    int64_t line = 0;
+
+    /* Links may only point at earlier nodes, so a damaged file cannot
+     * produce a cycle. */
+#define CACHE_LINK(flag, field) \
+        if (flags & (flag)) { \
+            if (!reader_varint(&at, end, &number) || number == 0 || number > i) goto done; \
+            node->field = &nodes[i - number]; \
+        } else { \
+            node->field = NULL; \
+        }
+    for (uint32_t i = 0; i < count; i++) {
+        ASTNode *node = &nodes[i];
+        uint64_t number;
+        if (end - at < 2) goto done;
+        unsigned char type = *at++;
+        unsigned char flags = *at++;
+        if (type >= AST_TYPE_COUNT) goto done;
+
+        node->type = (ASTNodeType)type;
+        CACHE_LINK(NODE_LEFT, left);
+        CACHE_LINK(NODE_RIGHT, right);
+        CACHE_LINK(NODE_CHILDREN, children);
+        CACHE_LINK(NODE_NEXT, next);
+        node->value = NULL;
+        if (flags & NODE_VALUE) {
+            if (!reader_varint(&at, end, &number) || number == 0 || number > string_bytes) goto done;
+            node->value = strings + number - 1;
+        }
+        node->op = 0;
+        if (flags & NODE_OP) {
+            if (at >= end || *at >= BINOP_COUNT) goto done;
+            node->op = (BinaryOperator)*at++;
+        }
+        node->call = (flags & NODE_CALL) != 0;
+        node->number = 0;
+        if (flags & NODE_NUMBER) {
+            if ((size_t)(end - at) < sizeof(double)) goto done;
+            memcpy(&node->number, at, sizeof(double));
+            at += sizeof(double);
+        }
+        if (!reader_varint(&at, end, &number)) goto done;
+        line += unzigzag(number);
+        node->line = (int)line;
+        if (!reader_varint(&at, end, &number)) goto done;
+        node->column = (int)unzigzag(number);
+
+        node->depth = -1;
+        node->slot = -1;
+        node->local_count = 0;
+        node->appends = 0;
+        node->proto = NULL;
+        node->shape = NULL;
+        node->cache = NULL;
+        node->builtin = NULL;
+        if ((node->type == AST_STRING || node->type == AST_FUNCTION_DEF) && node->value) {
+            node->value = (char*)arena_intern(arena, node->value, strlen(node->value));
+        }
+        if (node->type == AST_MEMBER_ACCESS && node->right && node->right->value) {
+            node->right->value = (char*)arena_intern(arena, node->right->value, strlen(node->right->value));
+        }
+    }
+#undef CACHE_LINK
+
+    if (at == end) program = &nodes[count - 1];
+done:
+    source_close(&file);
+    return program;
+}
+
+static ASTNode* parse_source(const SourceFile *source, Arena *arena) {
+    Lexer *lexer = lexer_create(source->data, source->length, arena);
+    lexer_tokenize(lexer);
+    Parser *parser = parser_create(lexer);
+    ASTNode *program = parser_parse(parser);
+    parser_destroy(parser);
+    lexer_destroy(lexer);
+    return program;
+}
+
+ASTNode* module_cache_parse(const char *path, Arena *arena) {
+    SourceFile source;
+    if (source_open(&source, path) != 0) {
+        return NULL;
+    }
+
+    ASTNode *program = cache_enabled ? cache_load(path, &source, arena) : NULL;
+    if (!program) {
+        program = parse_source(&source, arena);
+        if (cache_enabled) {
+            cache_store(path, &source, program);
+        }
+    }
+
+    source_close(&source);
+    return program;
+}
+
+ASTNode* module_parse_file(const char *path, Arena *arena) {
+    SourceFile source;
+    if (source_open(&source, path) != 0) {
+        return NULL;
+    }
+
+    ASTNode *program = parse_source(&source, arena);
+    source_close(&source);
+    return program;
+}
@@ -6,6 +6,7 @@
 Parser* parser_create(Lexer *lexer) {
     Parser *parser = malloc(sizeof(Parser));
     parser->lexer = lexer;
+    parser->arena = lexer->arena;
     parser->tokens = lexer->tokens;
     parser->token_count = lexer->token_count;
     parser->token_index = 0;
@@ -18,7 +19,7 @@ void parser_destroy(Parser *parser) {
 
 static Token parser_current_token(Parser *parser) {
     if (parser->token_index >= parser->token_count) {
-        Token eof = {TOKEN_EOF, NULL, 0, 0};
+        Token eof = {TOKEN_EOF, 0, 0, NULL, 0, 0};
         return eof;
     }
     return parser->tokens[parser->token_index];
@@ -26,12 +27,27 @@ static Token parser_current_token(Parser *parser) {
 
 static Token parser_peek_token(Parser *parser, int offset) {
     if (parser->token_index + offset >= parser->token_count) {
-        Token eof = {TOKEN_EOF, NULL, 0, 0};
+        Token eof = {TOKEN_EOF, 0, 0, NULL, 0, 0};
         return eof;
     }
     return parser->tokens[parser->token_index + offset];
 }
 
+/* Copies a token's text into the arena for nodes that keep it. */
+static char* parser_token_text(Parser *parser, Token token) {
+    return arena_strndup(parser->arena, lexer_token_chars(parser->lexer, token), token.length);
+}
+
+/* Member and method names are used as dict keys, so they are pooled. */
+static char* parser_token_name(Parser *parser, Token token) {
+    return (char*)arena_intern(parser->arena, lexer_token_chars(parser->lexer, token), token.length);
+}
+
+static int parser_token_is(Parser *parser, Token token, const char *word) {
+    return strlen(word) == token.length &&
+           memcmp(lexer_token_chars(parser->lexer, token), word, token.length) == 0;
+}
+
 static void parser_advance(Parser *parser) {
     if (parser->token_index < parser->token_count) {
         parser->token_index++;
@@ -46,41 +62,37 @@ static int parser_match(Parser *parser, TessTokenType type) {
     return 0;
 }
 
-ASTNode* ast_create_node(ASTNodeType type) {
-    ASTNode *node = malloc(sizeof(ASTNode));
+ASTNode* ast_create_node(Arena *arena, ASTNodeType type) {
+    ASTNode *node = arena_alloc(arena, sizeof(ASTNode));
     node->type = type;
     node->left = NULL;
     node->right = NULL;
     node->children = NULL;
     node->next = NULL;
     node->value = NULL;
+    node->number = 0;
+    node->op = BINOP_ADD;
+    node->call = 0;
     node->line = 0;
     node->column = 0;
+    node->depth = -1;
+    node->slot = -1;
+    node->local_count = 0;
+    node->appends = 0;
+    node->proto = NULL;
+    node->shape = NULL;
+    node->cache = NULL;
+    node->builtin = NULL;
     return node;
 }
 
-void ast_destroy_node(ASTNode *node) {
-    if (!node) return;
-    if (node->value) free(node->value);
-    free(node);
-}
-
-void ast_destroy_tree(ASTNode *root) {
-    if (!root) return;
-    ast_destroy_tree(root->left);
-    ast_destroy_tree(root->right);
-    ast_destroy_tree(root->children);
-    ast_destroy_tree(root->next);
-    ast_destroy_node(root);
-}
-
 ASTNode* parser_parse_expression(Parser *parser);
 ASTNode* parser_parse_statement(Parser *parser);
 ASTNode* parser_parse_block(Parser *parser);
 ASTNode* parser_parse_inner_block(Parser *parser);
 
 ASTNode* parser_parse_program(Parser *parser) {
-    ASTNode *program = ast_create_node(AST_PROGRAM);
+    ASTNode *program = ast_create_node(parser->arena, AST_PROGRAM);
     ASTNode *current = NULL;
 
     while (parser_current_token(parser).type != TOKEN_EOF) {
@@ -107,22 +119,26 @@ ASTNode* parser_parse_primary(Parser *parser) {
     Token token = parser_current_token(parser);
     
     if (token.type == TOKEN_NUMBER) {
-        ASTNode *node = ast_create_node(AST_NUMBER);
-        node->value = strdup(token.value);
+        ASTNode *node = ast_create_node(parser->arena, AST_NUMBER);
+        char digits[64];
+        size_t length = token.length < sizeof(digits) - 1 ? token.length : sizeof(digits) - 1;
+        memcpy(digits, lexer_token_chars(parser->lexer, token), length);
+        digits[length] = '\0';
+        node->number = strtod(digits, NULL);
         parser_advance(parser);
         return node;
     }
     
     if (token.type == TOKEN_STRING) {
-        ASTNode *node = ast_create_node(AST_STRING);
-        node->value = strdup(token.value);
+        ASTNode *node = ast_create_node(parser->arena, AST_STRING);
+        node->value = (char*)arena_intern(parser->arena, lexer_token_chars(parser->lexer, token), token.length);
         parser_advance(parser);
         return node;
     }
     
     if (token.type == TOKEN_REQUEST || token.type == TOKEN_HTTP) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_HTTP_REQUEST);
+        ASTNode *node = ast_create_node(parser->arena, AST_HTTP_REQUEST);
         node->left = parser_parse_expression(parser);
         node->right = parser_parse_expression(parser);
         Token next = parser_current_token(parser);
@@ -134,15 +150,14 @@ ASTNode* parser_parse_primary(Parser *parser) {
     }
     
     if (token.type == TOKEN_IDENTIFIER) {
-        ASTNode *node = ast_create_node(AST_IDENTIFIER);
-        node->value = strdup(token.value);
+        ASTNode *node = ast_create_node(parser->arena, AST_IDENTIFIER);
+        node->value = parser_token_text(parser, token);
         parser_advance(parser);
         
         if (parser_current_token(parser).type == TOKEN_LPAREN) {
             parser_advance(parser);
-            ASTNode *call_node = ast_create_node(AST_FUNCTION_CALL);
+            ASTNode *call_node = ast_create_node(parser->arena, AST_FUNCTION_CALL);
             call_node->value = node->value;
-            free(node);
             
             ASTNode *last_arg = NULL;
             while (parser_current_token(parser).type != TOKEN_RPAREN && 
@@ -167,18 +182,20 @@ ASTNode* parser_parse_primary(Parser *parser) {
             parser_advance(parser);
             Token member = parser_current_token(parser);
             if (member.type == TOKEN_IDENTIFIER) {
-                ASTNode *access_node = ast_create_node(AST_MEMBER_ACCESS);
+                ASTNode *access_node = ast_create_node(parser->arena, AST_MEMBER_ACCESS);
                 access_node->left = node;
+                access_node->line = member.line;
+                access_node->column = member.column;
                 
-                ASTNode *member_node = ast_create_node(AST_IDENTIFIER);
-                member_node->value = strdup(member.value);
+                ASTNode *member_node = ast_create_node(parser->arena, AST_IDENTIFIER);
+                member_node->value = parser_token_name(parser, member);
                 access_node->right = member_node;
                 
                 parser_advance(parser);
                 
                 if (parser_current_token(parser).type == TOKEN_LPAREN) {
                     parser_advance(parser);
-                    access_node->value = strdup("call");
+                    access_node->call = 1;
                     
                     ASTNode *last_arg = NULL;
                     while (parser_current_token(parser).type != TOKEN_RPAREN && 
@@ -216,8 +233,8 @@ ASTNode* parser_parse_primary(Parser *parser) {
         parser_advance(parser);
         Token class_name = parser_current_token(parser);
         if (class_name.type == TOKEN_IDENTIFIER) {
-            ASTNode *node = ast_create_node(AST_NEW);
-            node->value = strdup(class_name.value);
+            ASTNode *node = ast_create_node(parser->arena, AST_NEW);
+            node->value = parser_token_text(parser, class_name);
             parser_advance(parser);
             
             if (parser_current_token(parser).type == TOKEN_LPAREN) {
@@ -230,7 +247,7 @@ ASTNode* parser_parse_primary(Parser *parser) {
 
     if (token.type == TOKEN_LBRACKET) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_LIST);
+        ASTNode *node = ast_create_node(parser->arena, AST_LIST);
         ASTNode *last_item = NULL;
         
         while (parser_current_token(parser).type != TOKEN_RBRACKET &&
@@ -254,32 +271,33 @@ ASTNode* parser_parse_primary(Parser *parser) {
     return NULL;
 }
 
+static int parser_binary_operator(TessTokenType type, BinaryOperator *op) {
+    switch (type) {
+        case TOKEN_PLUS: *op = BINOP_ADD; return 1;
+        case TOKEN_MINUS: *op = BINOP_SUB; return 1;
+        case TOKEN_MULTIPLY: *op = BINOP_MUL; return 1;
+        case TOKEN_DIVIDE: *op = BINOP_DIV; return 1;
+        case TOKEN_PERCENT: *op = BINOP_MOD; return 1;
+        case TOKEN_GT: *op = BINOP_GT; return 1;
+        case TOKEN_LT: *op = BINOP_LT; return 1;
+        case TOKEN_EQ: *op = BINOP_EQ; return 1;
+        case TOKEN_NEQ: *op = BINOP_NEQ; return 1;
+        case TOKEN_GTE: *op = BINOP_GTE; return 1;
+        case TOKEN_LTE: *op = BINOP_LTE; return 1;
+        default: return 0;
+    }
+}
+
 ASTNode* parser_parse_expression(Parser *parser) {
     ASTNode *left = parser_parse_primary(parser);
+    BinaryOperator op;
     
-    while (parser_current_token(parser).type == TOKEN_PLUS ||
-           parser_current_token(parser).type == TOKEN_MINUS ||
-           parser_current_token(parser).type == TOKEN_MULTIPLY ||
-           parser_current_token(parser).type == TOKEN_DIVIDE ||
-           parser_current_token(parser).type == TOKEN_GT ||
-           parser_current_token(parser).type == TOKEN_LT ||
-           parser_current_token(parser).type == TOKEN_EQ ||
-           parser_current_token(parser).type == TOKEN_PERCENT
-           ) {
-        TessTokenType op = parser_current_token(parser).type;
-        char *op_str = NULL;
-        if (op == TOKEN_PLUS) op_str = "+";
-        else if (op == TOKEN_MINUS) op_str = "-";
-        else if (op == TOKEN_MULTIPLY) op_str = "*";
-        else if (op == TOKEN_DIVIDE) op_str = "/";
-        else if (op == TOKEN_GT) op_str = ">";
-        else if (op == TOKEN_LT) op_str = "<";
-        
+    while (parser_binary_operator(parser_current_token(parser).type, &op)) {
         parser_advance(parser);
         ASTNode *right = parser_parse_primary(parser);
         
-        ASTNode *node = ast_create_node(AST_BINARY_OP);
-        node->value = strdup(op_str ? op_str : "?");
+        ASTNode *node = ast_create_node(parser->arena, AST_BINARY_OP);
+        node->op = op;
         node->left = left;
         node->right = right;
         left = node;
@@ -295,9 +313,9 @@ ASTNode* parser_parse_function_def(Parser *parser) {
         parser_advance(parser);
     }
     
-    ASTNode *node = ast_create_node(AST_FUNCTION_DEF);
+    ASTNode *node = ast_create_node(parser->arena, AST_FUNCTION_DEF);
     if (parser_current_token(parser).type == TOKEN_IDENTIFIER) {
-        node->value = strdup(parser_current_token(parser).value);
+        node->value = parser_token_name(parser, parser_current_token(parser));
         parser_advance(parser);
     }
     
@@ -307,8 +325,8 @@ ASTNode* parser_parse_function_def(Parser *parser) {
         while (parser_current_token(parser).type != TOKEN_RPAREN &&
                parser_current_token(parser).type != TOKEN_EOF) {
             if (parser_current_token(parser).type == TOKEN_IDENTIFIER) {
-                ASTNode *param = ast_create_node(AST_VARIABLE_DECL);
-                param->value = strdup(parser_current_token(parser).value);
+                ASTNode *param = ast_create_node(parser->arena, AST_VARIABLE_DECL);
+                param->value = parser_token_text(parser, parser_current_token(parser));
                 if (last_param) last_param->next = param;
                 else node->left = param;
                 last_param = param;
@@ -332,9 +350,9 @@ ASTNode* parser_parse_function_def(Parser *parser) {
 
 ASTNode* parser_parse_class_def(Parser *parser) {
     parser_advance(parser);
-    ASTNode *node = ast_create_node(AST_CLASS_DEF);
+    ASTNode *node = ast_create_node(parser->arena, AST_CLASS_DEF);
     if (parser_current_token(parser).type == TOKEN_IDENTIFIER) {
-        node->value = strdup(parser_current_token(parser).value);
+        node->value = parser_token_text(parser, parser_current_token(parser));
         parser_advance(parser);
     }
     
@@ -344,7 +362,7 @@ ASTNode* parser_parse_class_def(Parser *parser) {
                parser_current_token(parser).type != TOKEN_EOF) {
             ASTNode *member = NULL;
             if (parser_current_token(parser).type == TOKEN_IDENTIFIER && 
-                strcmp(parser_current_token(parser).value, "f") == 0) {
+                parser_token_is(parser, parser_current_token(parser), "f")) {
                  member = parser_parse_function_def(parser);
             } else {
                  parser_advance(parser);
@@ -364,7 +382,7 @@ ASTNode* parser_parse_class_def(Parser *parser) {
 ASTNode* parser_parse_statement(Parser *parser) {
     Token token = parser_current_token(parser);
     
-    if (token.type == TOKEN_IDENTIFIER && strcmp(token.value, "f") == 0) {
+    if (token.type == TOKEN_IDENTIFIER && parser_token_is(parser, token, "f")) {
         if (parser_peek_token(parser, 1).type == TOKEN_EXCLAMATION) {
             return parser_parse_function_def(parser);
         }
@@ -376,14 +394,14 @@ ASTNode* parser_parse_statement(Parser *parser) {
     
     if (token.type == TOKEN_RETURN) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_RETURN);
+        ASTNode *node = ast_create_node(parser->arena, AST_RETURN);
         node->left = parser_parse_expression(parser);
         return node;
     }
     
     if (token.type == TOKEN_PRINT) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_PRINT);
+        ASTNode *node = ast_create_node(parser->arena, AST_PRINT);
         node->left = parser_parse_expression(parser);
         
         ASTNode *last = node->left;
@@ -398,7 +416,7 @@ ASTNode* parser_parse_statement(Parser *parser) {
     
     if (token.type == TOKEN_REQUEST || token.type == TOKEN_HTTP) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_HTTP_REQUEST);
+        ASTNode *node = ast_create_node(parser->arena, AST_HTTP_REQUEST);
         node->left = parser_parse_expression(parser);
         node->right = parser_parse_expression(parser);
         return node;
@@ -406,7 +424,7 @@ ASTNode* parser_parse_statement(Parser *parser) {
     
     if (token.type == TOKEN_WHILE) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_WHILE);
+        ASTNode *node = ast_create_node(parser->arena, AST_WHILE);
         node->left = parser_parse_expression(parser);
         parser_match(parser, TOKEN_LBRACE);
         node->children = parser_parse_block(parser);
@@ -415,7 +433,7 @@ ASTNode* parser_parse_statement(Parser *parser) {
     
     if (token.type == TOKEN_IF) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_IF);
+        ASTNode *node = ast_create_node(parser->arena, AST_IF);
         node->left = parser_parse_expression(parser);
         parser_match(parser, TOKEN_LBRACE);
         node->children = parser_parse_block(parser);
@@ -431,8 +449,8 @@ ASTNode* parser_parse_statement(Parser *parser) {
         parser_advance(parser);
         Token module_token = parser_current_token(parser);
         if (module_token.type == TOKEN_IDENTIFIER) {
-            ASTNode *node = ast_create_node(AST_IMPORT);
-            node->value = strdup(module_token.value);
+            ASTNode *node = ast_create_node(parser->arena, AST_IMPORT);
+            node->value = parser_token_text(parser, module_token);
             parser_advance(parser);
             return node;
         }
@@ -443,32 +461,35 @@ ASTNode* parser_parse_statement(Parser *parser) {
         parser_advance(parser);
         Token module_token = parser_current_token(parser);
         if (module_token.type == TOKEN_IDENTIFIER) {
-            ASTNode *node = ast_create_node(AST_IMPORT);
-            char module_path[512] = {0};
-            strcpy(module_path, module_token.value);
+            ASTNode *node = ast_create_node(parser->arena, AST_IMPORT);
+            char *module_path = parser_token_text(parser, module_token);
             parser_advance(parser);
             
             Token next = parser_current_token(parser);
-            if (next.type == TOKEN_IDENTIFIER && strcmp(next.value, "from") == 0) {
+            if (next.type == TOKEN_IDENTIFIER && parser_token_is(parser, next, "from")) {
                 parser_advance(parser);
                 Token from_module = parser_current_token(parser);
                 if (from_module.type == TOKEN_IDENTIFIER) {
-                    snprintf(module_path, sizeof(module_path), "%s/%s", from_module.value, module_token.value);
+                    size_t length = from_module.length + 1 + module_token.length;
+                    module_path = arena_alloc(parser->arena, length + 1);
+                    snprintf(module_path, length + 1, "%.*s/%.*s",
+                             (int)from_module.length, lexer_token_chars(parser->lexer, from_module),
+                             (int)module_token.length, lexer_token_chars(parser->lexer, module_token));
                     parser_advance(parser);
                 }
             }
             next = parser_current_token(parser);
-            if (next.type == TOKEN_IDENTIFIER && strcmp(next.value, "as") == 0) {
+            if (next.type == TOKEN_IDENTIFIER && parser_token_is(parser, next, "as")) {
                 parser_advance(parser);
                 Token alias = parser_current_token(parser);
                 if (alias.type == TOKEN_IDENTIFIER || alias.type == TOKEN_NUMBER) {
-                    node->right = ast_create_node(AST_IDENTIFIER);
-                    node->right->value = strdup(alias.value);
+                    node->right = ast_create_node(parser->arena, AST_IDENTIFIER);
+                    node->right->value = parser_token_text(parser, alias);
                     parser_advance(parser);
                 }
             }
             
-            node->value = strdup(module_path);
+            node->value = module_path;
             return node;
         }
         return NULL;
@@ -485,7 +506,7 @@ ASTNode* parser_parse_statement(Parser *parser) {
             if (parser_current_token(parser).type == TOKEN_DOT) {
                 parser_advance(parser);
             } else if (parser_current_token(parser).type == TOKEN_IDENTIFIER) {
-                entry_point = parser_current_token(parser).value;
+                entry_point = parser_token_text(parser, parser_current_token(parser));
                 parser_advance(parser);
             }
             
@@ -493,16 +514,16 @@ ASTNode* parser_parse_statement(Parser *parser) {
                 parser_advance(parser);
             }
             
-            ASTNode *node = ast_create_node(AST_MAIN_CALL);
-            node->value = strdup(entry_point);
+            ASTNode *node = ast_create_node(parser->arena, AST_MAIN_CALL);
+            node->value = entry_point;
             return node;
         }
     }
     
     if (token.type == TOKEN_IDENTIFIER) {
         if (parser_peek_token(parser, 1).type == TOKEN_ASSIGN) {
-            ASTNode *node = ast_create_node(AST_ASSIGNMENT);
-            node->value = strdup(token.value);
+            ASTNode *node = ast_create_node(parser->arena, AST_ASSIGNMENT);
+            node->value = parser_token_text(parser, token);
             parser_advance(parser);
             parser_advance(parser);
             node->right = parser_parse_expression(parser);
@@ -520,7 +541,7 @@ ASTNode* parser_parse_statement(Parser *parser) {
     
     if (token.type == TOKEN_REPEAT) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_REPEAT);
+        ASTNode *node = ast_create_node(parser->arena, AST_REPEAT);
         node->left = parser_parse_expression(parser);
         if (parser_current_token(parser).type == TOKEN_LBRACE) {
             parser_advance(parser);
@@ -534,7 +555,7 @@ ASTNode* parser_parse_statement(Parser *parser) {
     
     if (token.type == TOKEN_TRY) {
         parser_advance(parser);
-        ASTNode *node = ast_create_node(AST_TRY);
+        ASTNode *node = ast_create_node(parser->arena, AST_TRY);
         
         if (parser_match(parser, TOKEN_LBRACE)) {
             node->left = parser_parse_block(parser);
@@ -553,7 +574,7 @@ ASTNode* parser_parse_statement(Parser *parser) {
 }
 
 ASTNode* parser_parse_block(Parser *parser) {
-    ASTNode *block = ast_create_node(AST_BLOCK);
+    ASTNode *block = ast_create_node(parser->arena, AST_BLOCK);
     ASTNode *current = NULL;
     
     while (parser_current_token(parser).type != TOKEN_RBRACE && 
@@ -575,7 +596,7 @@ ASTNode* parser_parse_block(Parser *parser) {
 }
 
 ASTNode* parser_parse_inner_block(Parser *parser) {
-    ASTNode *block = ast_create_node(AST_INNER_BLOCK);
+    ASTNode *block = ast_create_node(parser->arena, AST_INNER_BLOCK);
     ASTNode *current = NULL;
     
     while (parser_current_token(parser).type != TOKEN_GT_GT && 
@@ -0,0 +1,296 @@
+#include <stdlib.h>
+#include <string.h>
+#include "resolver.h"
+#include "builtins.h"
+
+typedef struct {
+    const char **names;
+    int count;
+    int capacity;
+} ResolverScope;
+
+typedef struct {
+    Interpreter *interpreter;
+    ResolverScope *scopes;
+    int scope_count;
+    int scope_capacity;
+    int in_function;
+    ASTNode **pending;
+    size_t pending_count;
+    size_t pending_capacity;
+} Resolver;
+
+static void resolve_node(Resolver *r, ASTNode *node);
+static void resolve_function(Resolver *r, ASTNode *func_node);
+
+static void resolve_list(Resolver *r, ASTNode *node) {
+    for (; node; node = node->next) {
+        resolve_node(r, node);
+    }
+}
+
+static void scope_open(Resolver *r) {
+    if (r->scope_count >= r->scope_capacity) {
+        r->scope_capacity = r->scope_capacity == 0 ? 8 : r->scope_capacity * 2;
+        r->scopes = realloc(r->scopes, sizeof(ResolverScope) * r->scope_capacity);
+    }
+    ResolverScope *scope = &r->scopes[r->scope_count++];
+    scope->names = NULL;
+    scope->count = 0;
+    scope->capacity = 0;
+}
+
+static int scope_close(Resolver *r) {
+    ResolverScope *scope = &r->scopes[--r->scope_count];
+    free(scope->names);
+    return scope->count;
+}
+
+static int scope_declare(Resolver *r, const char *name) {
+    ResolverScope *scope = &r->scopes[r->scope_count - 1];
+    if (scope->count >= scope->capacity) {
+        scope->capacity = scope->capacity == 0 ? 4 : scope->capacity * 2;
+        scope->names = realloc(scope->names, sizeof(char*) * scope->capacity);
+    }
+    scope->names[scope->count] = name;
+    return scope->count++;
+}
+
+static int resolve_local(Resolver *r, const char *name, int *slot) {
+    for (int i = r->scope_count - 1; i >= 0; i--) {
+        ResolverScope *scope = &r->scopes[i];
+        for (int j = 0; j < scope->count; j++) {
+            if (strcmp(scope->names[j], name) == 0) {
+                *slot = j;
+                return r->scope_count - 1 - i;
+            }
+        }
+    }
+    return -1;
+}
+
+static void resolve_read(Resolver *r, ASTNode *node, const char *name) {
+    node->depth = resolve_local(r, name, &node->slot);
+    if (node->depth < 0) {
+        node->slot = interpreter_global_slot(r->interpreter, name);
+    }
+}
+
+/* Inside a function, assigning a name that is neither a visible local nor a
+ * global defined at top level declares a local in the innermost block. */
+static void resolve_write(Resolver *r, ASTNode *node, const char *name) {
+    node->depth = resolve_local(r, name, &node->slot);
+    if (node->depth >= 0) return;
+
+    if (r->in_function) {
+        int global = interpreter_find_global(r->interpreter, name);
+        if (global < 0 || !r->interpreter->globals[global].defined) {
+            node->depth = 0;
+            node->slot = scope_declare(r, name);
+            return;
+        }
+    }
+
+    node->slot = interpreter_global_slot(r->interpreter, name);
+    r->interpreter->globals[node->slot].defined = 1;
+}
+
+static int reads_binding(ASTNode *node, ASTNode *target);
+
+static int reads_binding_list(ASTNode *node, ASTNode *target) {
+    for (; node; node = node->next) {
+        if (reads_binding(node, target)) return 1;
+    }
+    return 0;
+}
+
+static int reads_binding(ASTNode *node, ASTNode *target) {
+    if ((node->type == AST_IDENTIFIER || node->type == AST_FUNCTION_CALL || node->type == AST_NEW) &&
+        node->depth == target->depth && node->slot == target->slot) {
+        return 1;
+    }
+    return reads_binding_list(node->left, target) ||
+           reads_binding_list(node->right, target) ||
+           reads_binding_list(node->children, target);
+}
+
+static int resolve_appends(ASTNode *node) {
+    if (node->depth < 0) return 0;
+    int count = 0;
+    for (ASTNode *sum = node->right; sum && sum->type == AST_BINARY_OP && sum->op == BINOP_ADD; sum = sum->left) {
+        if (!sum->right || reads_binding(sum->right, node)) return 0;
+        count++;
+        ASTNode *left = sum->left;
+        if (left && left->type == AST_IDENTIFIER && left->depth == node->depth && left->slot == node->slot) {
+            return count;
+        }
+    }
+    return 0;
+}
+
+/* Top-level function bodies are resolved once every global is known. */
+static void resolve_later(Resolver *r, ASTNode *func_node) {
+    if (r->in_function) {
+        resolve_function(r, func_node);
+        return;
+    }
+    if (r->pending_count >= r->pending_capacity) {
+        r->pending_capacity = r->pending_capacity == 0 ? 16 : r->pending_capacity * 2;
+        r->pending = realloc(r->pending, sizeof(ASTNode*) * r->pending_capacity);
+    }
+    r->pending[r->pending_count++] = func_node;
+}
+
+static void resolve_function(Resolver *r, ASTNode *func_node) {
+    Resolver inner = {r->interpreter, NULL, 0, 0, 1, NULL, 0, 0};
+    scope_open(&inner);
+
+    for (ASTNode *param = func_node->left; param; param = param->next) {
+        param->depth = 0;
+        param->slot = scope_declare(&inner, param->value ? param->value : "");
+    }
+
+    ASTNode *body = func_node->children;
+    if (body && (body->type == AST_BLOCK || body->type == AST_INNER_BLOCK)) {
+        resolve_list(&inner, body->children);
+    } else if (body) {
+        resolve_node(&inner, body);
+    }
+
+    func_node->local_count = scope_close(&inner);
+    free(inner.scopes);
+}
+
+static void resolve_block(Resolver *r, ASTNode *block) {
+    if (!block) return;
+    if (block->type != AST_BLOCK) {
+        resolve_node(r, block);
+        return;
+    }
+    scope_open(r);
+    resolve_list(r, block->children);
+    block->local_count = scope_close(r);
+}
+
+static void resolve_node(Resolver *r, ASTNode *node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case AST_PROGRAM:
+        case AST_INNER_BLOCK:
+            resolve_list(r, node->children);
+            break;
+
+        case AST_BLOCK:
+            resolve_block(r, node);
+            break;
+
+        case AST_IDENTIFIER:
+            resolve_read(r, node, node->value);
+            break;
+
+        case AST_ASSIGNMENT:
+            resolve_node(r, node->right);
+            resolve_write(r, node, node->value);
+            node->appends = resolve_appends(node);
+            break;
+
+        case AST_BINARY_OP:
+        case AST_INDEX:
+            resolve_node(r, node->left);
+            resolve_node(r, node->right);
+            break;
+
+        case AST_FUNCTION_CALL:
+            node->builtin = get_builtin(node->value);
+            resolve_read(r, node, node->value);
+            resolve_list(r, node->left);
+            break;
+
+        case AST_MAIN_CALL:
+            node->depth = -1;
+            node->slot = interpreter_global_slot(r->interpreter, node->value ? node->value : "main");
+            break;
+
+        case AST_NEW:
+            resolve_read(r, node, node->value);
+            break;
+
+        case AST_MEMBER_ACCESS:
+            if (node->right && node->right->value) {
+                node->builtin = get_builtin(node->right->value);
+            }
+            resolve_node(r, node->left);
+            resolve_list(r, node->children);
+            break;
+
+        case AST_LIST:
+            resolve_list(r, node->children);
+            break;
+
+        case AST_PRINT:
+            resolve_list(r, node->left);
+            break;
+
+        case AST_HTTP_REQUEST:
+            resolve_node(r, node->left);
+            resolve_node(r, node->right);
+            resolve_node(r, node->children);
+            break;
+
+        case AST_IF:
+            resolve_node(r, node->left);
+            resolve_block(r, node->children);
+            resolve_block(r, node->right);
+            break;
+
+        case AST_WHILE:
+        case AST_REPEAT:
+            resolve_node(r, node->left);
+            resolve_block(r, node->children);
+            break;
+
+        case AST_RETURN:
+            resolve_node(r, node->left);
+            break;
+
+        case AST_TRY:
+            resolve_block(r, node->left);
+            scope_open(r);
+            scope_declare(r, "error");
+            resolve_block(r, node->right);
+            node->local_count = scope_close(r);
+            break;
+
+        case AST_FUNCTION_DEF:
+            if (node->value) {
+                resolve_write(r, node, node->value);
+            }
+            resolve_later(r, node);
+            break;
+
+        case AST_CLASS_DEF:
+            if (node->value) {
+                resolve_write(r, node, node->value);
+            }
+            for (ASTNode *member = node->children; member; member = member->next) {
+                if (member->type == AST_FUNCTION_DEF) {
+                    resolve_later(r, member);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void resolver_resolve(Interpreter *interpreter, ASTNode *program) {
+    Resolver r = {interpreter, NULL, 0, 0, 0, NULL, 0, 0};
+    resolve_node(&r, program);
+    for (size_t i = 0; i < r.pending_count; i++) {
+        resolve_function(&r, r.pending[i]);
+    }
+    free(r.pending);
+    free(r.scopes);
+}
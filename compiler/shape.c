@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <string.h>
+#include "shape.h"
+#include "dict.h"
+#include "string_pool.h"
+
+Shape* shape_create(void) {
+    Shape *shape = malloc(sizeof(Shape));
+    dict_init(&shape->fields, 0);
+    dict_init(&shape->methods, 0);
+    return shape;
+}
+
+static char* shape_name(const char *name) {
+    return (char*)string_pool_intern(name, strlen(name));
+}
+
+int shape_add_field(Shape *shape, const char *name) {
+    int slot = (int)shape->fields.count;
+    dict_set(&shape->fields, shape_name(name), value_number(slot));
+    return slot;
+}
+
+void shape_add_method(Shape *shape, const char *name, Value method) {
+    dict_set(&shape->methods, shape_name(name), method);
+}
+
+Shape* shape_for_class(ASTNode *class_def) {
+    if (!class_def->shape) {
+        Shape *shape = shape_create();
+        for (ASTNode *member = class_def->children; member; member = member->next) {
+            if (member->type == AST_FUNCTION_DEF && member->value) {
+                shape_add_method(shape, member->value, value_function(member));
+            }
+        }
+        class_def->shape = shape;
+    }
+    return class_def->shape;
+}
+
+/* Sets *slot to name's field slot, or to -1 and *method to its method. */
+int shape_lookup(Shape *shape, const char *name, int *slot, Value *method) {
+    Value *member = dict_find(&shape->fields, name);
+    if (member) {
+        *slot = (int)value_as_number(*member);
+        return 1;
+    }
+    member = dict_find(&shape->methods, name);
+    if (member) {
+        *slot = -1;
+        *method = *member;
+        return 1;
+    }
+    return 0;
+}
+
+int shape_find(const Object *object, const char *name, Value *out) {
+    int slot;
+    Value method;
+    if (!shape_lookup(object->shape, name, &slot, &method)) return 0;
+    *out = slot >= 0 ? object->fields[slot] : method;
+    return 1;
+}
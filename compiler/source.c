@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "source.h"
+
+/* Returns 0 on success. An empty file maps to an empty string. */
+int source_open(SourceFile *source, const char *path) {
+    source->data = "";
+    source->length = 0;
+    source->mtime = 0;
+    source->mapped = 0;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 1;
+
+    LARGE_INTEGER size;
+    FILETIME written;
+    if (!GetFileSizeEx(file, &size) || !GetFileTime(file, NULL, NULL, &written)) {
+        CloseHandle(file);
+        return 1;
+    }
+    /* FILETIME counts 100 ns intervals since 1601. */
+    uint64_t ticks = ((uint64_t)written.dwHighDateTime << 32) | written.dwLowDateTime;
+    source->mtime = (int64_t)((ticks - 116444736000000000ULL) / 10000000ULL);
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        return 0;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return 1;
+    const char *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) return 1;
+
+    source->data = data;
+    source->length = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 1;
+    }
+    source->mtime = (int64_t)st.st_mtime;
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return 1;
+
+    source->data = data;
+    source->length = (size_t)st.st_size;
+#endif
+    source->mapped = 1;
+    return 0;
+}
+
+void source_close(SourceFile *source) {
+    if (!source->mapped) return;
+#ifdef _WIN32
+    UnmapViewOfFile(source->data);
+#else
+    munmap((void*)source->data, source->length);
+#endif
+    source->mapped = 0;
+}
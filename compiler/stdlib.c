@@ -4,219 +4,214 @@
 #include <math.h>
 #include <time.h>
 #include "tess_stdlib.h"
+#include "tess_alloc.h"
+#include "tess_string.h"
 
 Value stdlib_print(Value *args, int argc) {
     for (int i = 0; i < argc; i++) {
-        if (args[i].type == VALUE_STRING) {
-            printf("%s", args[i].as.string);
-        } else if (args[i].type == VALUE_NUMBER) {
-            printf("%g", args[i].as.number);
-        } else if (args[i].type == VALUE_NULL) {
+        if (value_type(args[i]) == VALUE_STRING) {
+            printf("%s", value_as_string(args[i]));
+        } else if (value_type(args[i]) == VALUE_NUMBER) {
+            printf("%g", value_as_number(args[i]));
+        } else if (value_type(args[i]) == VALUE_NULL) {
             printf("null");
-        } else if (args[i].type == VALUE_BOOLEAN) {
-            printf(args[i].as.boolean ? "true" : "false");
-        } else if (args[i].type == VALUE_LIST) {
+        } else if (value_type(args[i]) == VALUE_BOOLEAN) {
+            printf(value_as_boolean(args[i]) ? "true" : "false");
+        } else if (value_type(args[i]) == VALUE_LIST) {
             printf("[List]");
-        } else if (args[i].type == VALUE_DICT) {
+        } else if (value_type(args[i]) == VALUE_DICT) {
             printf("[Dict]");
         }
         if (i < argc - 1) printf(" ");
     }
     printf("\n");
-    return (Value){VALUE_NULL, {0}};
+    return value_null();
 }
 
 Value stdlib_sqrt(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_NUMBER) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 1 || value_type(args[0]) != VALUE_NUMBER) {
+        return value_null();
     }
-    return (Value){VALUE_NUMBER, {.number = sqrt(args[0].as.number)}};
+    return value_number(sqrt(value_as_number(args[0])));
 }
 
 Value stdlib_len(Value *args, int argc) {
-    if (argc < 1) return (Value){VALUE_NUMBER, {.number = 0}};
-    
-    if (args[0].type == VALUE_STRING) {
-        return (Value){VALUE_NUMBER, {.number = strlen(args[0].as.string)}};
-    } else if (args[0].type == VALUE_LIST) {
-        return (Value){VALUE_NUMBER, {.number = args[0].as.list->count}};
-    } else if (args[0].type == VALUE_DICT) {
-        return (Value){VALUE_NUMBER, {.number = args[0].as.dict->count}};
+    if (argc < 1) return value_number(0);
+    
+    if (value_type(args[0]) == VALUE_STRING) {
+        return value_number(string_length(value_as_string(args[0])));
+    } else if (value_type(args[0]) == VALUE_LIST) {
+        return value_number(value_as_list(args[0])->count);
+    } else if (value_type(args[0]) == VALUE_DICT) {
+        return value_number(value_as_dict(args[0])->count);
     }
     
-    return (Value){VALUE_NUMBER, {.number = 0}};
+    return value_number(0);
 }
 
 Value stdlib_file_open(Value *args, int argc) {
-    if (argc < 2 || args[0].type != VALUE_STRING || args[1].type != VALUE_STRING) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 2 || value_type(args[0]) != VALUE_STRING || value_type(args[1]) != VALUE_STRING) {
+        return value_null();
     }
     
-    FILE *f = fopen(args[0].as.string, args[1].as.string);
-    if (!f) return (Value){VALUE_NULL, {0}};
+    FILE *f = fopen(value_as_string(args[0]), value_as_string(args[1]));
+    if (!f) return value_null();
     
-    Value val;
-    val.type = VALUE_FILE;
-    val.as.file = f;
-    return val;
+    return value_file(f);
 }
 
 Value stdlib_file_write(Value *args, int argc) {
-    if (argc < 2 || args[0].type != VALUE_FILE || args[1].type != VALUE_STRING) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 2 || value_type(args[0]) != VALUE_FILE || value_type(args[1]) != VALUE_STRING) {
+        return value_null();
     }
     
-    fputs(args[1].as.string, args[0].as.file);
-    return (Value){VALUE_NULL, {0}};
+    fputs(value_as_string(args[1]), value_as_file(args[0]));
+    return value_null();
 }
 
-Value stdlib_file_read(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_FILE) {
-        return (Value){VALUE_NULL, {0}};
-    }
-    
-    FILE *f = args[0].as.file;
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
+/* Reads f from the start, or from where it is if it cannot seek, until
+ * end of file. The size ftell reports is not trusted: pipes and
+ * directories have none, and text mode can return fewer bytes than it
+ * counts, so the string holds exactly what was read. A read error is
+ * null. */
+static Value stdlib_read_all(FILE *f) {
     fseek(f, 0, SEEK_SET);
     
-    char *content = malloc(size + 1);
-    fread(content, 1, size, f);
-    content[size] = '\0';
+    size_t capacity = 4096;
+    size_t length = 0;
+    char *buffer = tess_malloc(capacity);
+    for (;;) {
+        length += fread(buffer + length, 1, capacity - length, f);
+        if (length < capacity) break;
+        capacity *= 2;
+        buffer = tess_realloc(buffer, capacity);
+    }
+    
+    Value content = ferror(f) ? value_null() : value_string(gc_substring(buffer, length));
+    free(buffer);
+    return content;
+}
+
+Value stdlib_file_read(Value *args, int argc) {
+    if (argc < 1 || value_type(args[0]) != VALUE_FILE) {
+        return value_null();
+    }
     
-    Value val;
-    val.type = VALUE_STRING;
-    val.as.string = content;
-    return val;
+    return stdlib_read_all(value_as_file(args[0]));
 }
 
 Value stdlib_file_close(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_FILE) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 1 || value_type(args[0]) != VALUE_FILE) {
+        return value_null();
     }
     
-    fclose(args[0].as.file);
-    return (Value){VALUE_NULL, {0}};
+    fclose(value_as_file(args[0]));
+    return value_null();
 }
 
 Value stdlib_read_file(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_STRING) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 1 || value_type(args[0]) != VALUE_STRING) {
+        return value_null();
     }
     
-    FILE *f = fopen(args[0].as.string, "r");
-    if (!f) return (Value){VALUE_NULL, {0}};
-    
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    FILE *f = fopen(value_as_string(args[0]), "r");
+    if (!f) return value_null();
     
-    char *content = malloc(size + 1);
-    fread(content, 1, size, f);
-    content[size] = '\0';
+    Value content = stdlib_read_all(f);
     fclose(f);
     
-    Value val;
-    val.type = VALUE_STRING;
-    val.as.string = content;
-    return val;
+    return content;
 }
 
 Value stdlib_write_file(Value *args, int argc) {
-    if (argc < 2 || args[0].type != VALUE_STRING || args[1].type != VALUE_STRING) {
-        return (Value){VALUE_NUMBER, {.number = 0}};
+    if (argc < 2 || value_type(args[0]) != VALUE_STRING || value_type(args[1]) != VALUE_STRING) {
+        return value_number(0);
     }
     
-    FILE *f = fopen(args[0].as.string, "w");
-    if (!f) return (Value){VALUE_NUMBER, {.number = 0}};
+    FILE *f = fopen(value_as_string(args[0]), "w");
+    if (!f) return value_number(0);
     
-    fputs(args[1].as.string, f);
+    fputs(value_as_string(args[1]), f);
     fclose(f);
     
-    return (Value){VALUE_NUMBER, {.number = 1}};
+    return value_number(1);
 }
 
 Value stdlib_mem_alloc(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_NUMBER) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 1 || value_type(args[0]) != VALUE_NUMBER) {
+        return value_null();
     }
     
-    size_t size = (size_t)args[0].as.number;
-    void *ptr = malloc(size);
+    size_t size = (size_t)value_as_number(args[0]);
+    void *ptr = tess_malloc(size);
     
-    Value val;
-    val.type = VALUE_NUMBER;
-    val.as.number = (double)(unsigned long long)ptr;
-    return val;
+    return value_number((double)(unsigned long long)ptr);
 }
 
 Value stdlib_mem_free(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_NUMBER) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 1 || value_type(args[0]) != VALUE_NUMBER) {
+        return value_null();
     }
     
-    void *ptr = (void*)(unsigned long long)args[0].as.number;
+    void *ptr = (void*)(unsigned long long)value_as_number(args[0]);
     free(ptr);
-    return (Value){VALUE_NULL, {0}};
+    return value_null();
 }
 
 Value stdlib_mem_write(Value *args, int argc) {
-    if (argc < 3 || args[0].type != VALUE_NUMBER || args[1].type != VALUE_NUMBER || args[2].type != VALUE_NUMBER) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 3 || value_type(args[0]) != VALUE_NUMBER || value_type(args[1]) != VALUE_NUMBER || value_type(args[2]) != VALUE_NUMBER) {
+        return value_null();
     }
     
-    void *ptr = (void*)(unsigned long long)args[0].as.number;
-    size_t offset = (size_t)args[1].as.number;
-    unsigned char val = (unsigned char)args[2].as.number;
+    void *ptr = (void*)(unsigned long long)value_as_number(args[0]);
+    size_t offset = (size_t)value_as_number(args[1]);
+    unsigned char val = (unsigned char)value_as_number(args[2]);
     
     ((unsigned char*)ptr)[offset] = val;
-    return (Value){VALUE_NULL, {0}};
+    return value_null();
 }
 
 Value stdlib_mem_read(Value *args, int argc) {
-    if (argc < 2 || args[0].type != VALUE_NUMBER || args[1].type != VALUE_NUMBER) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 2 || value_type(args[0]) != VALUE_NUMBER || value_type(args[1]) != VALUE_NUMBER) {
+        return value_null();
     }
     
-    void *ptr = (void*)(unsigned long long)args[0].as.number;
-    size_t offset = (size_t)args[1].as.number;
+    void *ptr = (void*)(unsigned long long)value_as_number(args[0]);
+    size_t offset = (size_t)value_as_number(args[1]);
     
     unsigned char val = ((unsigned char*)ptr)[offset];
     
-    Value res;
-    res.type = VALUE_NUMBER;
-    res.as.number = val;
-    return res;
+    return value_number(val);
 }
 
 Value stdlib_sys_sleep(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_NUMBER) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 1 || value_type(args[0]) != VALUE_NUMBER) {
+        return value_null();
     }
     
 #ifdef _WIN32
-    _sleep((int)args[0].as.number);
+    _sleep((int)value_as_number(args[0]));
 #else
-    usleep((int)(args[0].as.number * 1000));
+    usleep((int)(value_as_number(args[0]) * 1000));
 #endif
-    return (Value){VALUE_NULL, {0}};
+    return value_null();
 }
 
 Value stdlib_sys_exit(Value *args, int argc) {
     int code = 0;
-    if (argc > 0 && args[0].type == VALUE_NUMBER) {
-        code = (int)args[0].as.number;
+    if (argc > 0 && value_type(args[0]) == VALUE_NUMBER) {
+        code = (int)value_as_number(args[0]);
     }
     exit(code);
-    return (Value){VALUE_NULL, {0}};
+    return value_null();
 }
 
 Value stdlib_asm_alloc_exec(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_NUMBER) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 1 || value_type(args[0]) != VALUE_NUMBER) {
+        return value_null();
     }
     
-    size_t size = (size_t)args[0].as.number;
+    size_t size = (size_t)value_as_number(args[0]);
     
 #ifdef _WIN32
     void *ptr = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
@@ -224,50 +219,44 @@ Value stdlib_asm_alloc_exec(Value *args, int argc) {
     void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 #endif
     
-    Value val;
-    val.type = VALUE_NUMBER;
-    val.as.number = (double)(unsigned long long)ptr;
-    return val;
+    return value_number((double)(unsigned long long)ptr);
 }
 
 Value stdlib_asm_exec(Value *args, int argc) {
-    if (argc < 1 || args[0].type != VALUE_NUMBER) {
-        return (Value){VALUE_NULL, {0}};
+    if (argc < 1 || value_type(args[0]) != VALUE_NUMBER) {
+        return value_null();
     }
     
-    void (*func)() = (void (*)())(unsigned long long)args[0].as.number;
+    void (*func)() = (void (*)())(unsigned long long)value_as_number(args[0]);
     func();
     
-    return (Value){VALUE_NULL, {0}};
+    return value_null();
 }
 
 Value stdlib_json_format(Value *args, int argc) {
-    if (argc < 1) return (Value){VALUE_NULL, {0}};
+    if (argc < 1) return value_null();
     
     Value v = args[0];
-    if (v.type == VALUE_STRING) {
-        size_t len = strlen(v.as.string) + 3;
-        char *s = malloc(len);
-        snprintf(s, len, "\"%s\"", v.as.string);
-        return (Value){VALUE_STRING, {.string = s}};
-    } else if (v.type == VALUE_NUMBER) {
-        char *s = malloc(32);
-        snprintf(s, 32, "%g", v.as.number);
-        return (Value){VALUE_STRING, {.string = s}};
-    } else if (v.type == VALUE_NULL) {
-        return (Value){VALUE_STRING, {.string = strdup("null")}};
-    } else if (v.type == VALUE_BOOLEAN) {
-        return (Value){VALUE_STRING, {.string = strdup(v.as.boolean ? "true" : "false")}};
+    if (value_type(v) == VALUE_STRING) {
+        size_t len = string_length(value_as_string(v)) + 3;
+        char *s = gc_string(len - 1);
+        snprintf(s, len, "\"%s\"", value_as_string(v));
+        return value_string(s);
+    } else if (value_type(v) == VALUE_NUMBER) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%g", value_as_number(v));
+        return value_string(gc_strdup(buffer));
+    } else if (value_type(v) == VALUE_NULL) {
+        return value_string(gc_strdup("null"));
+    } else if (value_type(v) == VALUE_BOOLEAN) {
+        return value_string(gc_strdup(value_as_boolean(v) ? "true" : "false"));
     }
     
-    return (Value){VALUE_STRING, {.string = strdup("{}")}}; 
+    return value_string(gc_strdup("{}")); 
 }
 
 Value stdlib_clock(Value *args, int argc) {
     (void)args;
     (void)argc;
-    Value v;
-    v.type = VALUE_NUMBER;
-    v.as.number = (double)clock() / CLOCKS_PER_SEC;
-    return v;
+    return value_number((double)clock() / CLOCKS_PER_SEC);
 }
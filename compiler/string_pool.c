@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "string_pool.h"
+#include "tess_alloc.h"
+#include "gc.h"
+
+/* The GC header sits right before the text so a pooled string can be handed
+ * out as a Value; the collector sees it as permanent and leaves it alone. */
+typedef struct PooledString {
+    struct PooledString *next;
+    unsigned long hash;
+    size_t length;
+    size_t refcount;
+    GCObject header;
+    char chars[];
+} PooledString;
+
+_Static_assert(offsetof(PooledString, chars) == offsetof(PooledString, header) + sizeof(GCObject),
+               "pooled text must follow its GC header");
+
+static PooledString **pool_buckets = NULL;
+static size_t pool_capacity = 0;
+static size_t pool_count = 0;
+
+static unsigned long pool_hash(const char *chars, size_t length) {
+    unsigned long hash = 5381;
+    for (size_t i = 0; i < length; i++) {
+        hash = ((hash << 5) + hash) + (unsigned char)chars[i];
+    }
+    return hash;
+}
+
+static PooledString* pool_entry(const char *str) {
+    return (PooledString*)(str - offsetof(PooledString, chars));
+}
+
+static void pool_grow(void) {
+    size_t capacity = pool_capacity == 0 ? 256 : pool_capacity * 2;
+    PooledString **buckets = tess_calloc(capacity, sizeof(PooledString*));
+    for (size_t i = 0; i < pool_capacity; i++) {
+        PooledString *entry = pool_buckets[i];
+        while (entry) {
+            PooledString *next = entry->next;
+            size_t index = entry->hash & (capacity - 1);
+            entry->next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+    free(pool_buckets);
+    pool_buckets = buckets;
+    pool_capacity = capacity;
+}
+
+const char* string_pool_intern(const char *chars, size_t length) {
+    unsigned long hash = pool_hash(chars, length);
+    if (pool_capacity > 0) {
+        for (PooledString *entry = pool_buckets[hash & (pool_capacity - 1)]; entry; entry = entry->next) {
+            if (entry->hash == hash && entry->length == length &&
+                memcmp(entry->chars, chars, length) == 0) {
+                entry->refcount++;
+                return entry->chars;
+            }
+        }
+    }
+
+    if (pool_count * 2 >= pool_capacity) {
+        pool_grow();
+    }
+
+    PooledString *entry = tess_malloc(sizeof(PooledString) + length + 1);
+    entry->hash = hash;
+    entry->length = length;
+    entry->refcount = 1;
+    entry->header.next = NULL;
+    entry->header.size = length + 1;
+    entry->header.kind = GC_STRING;
+    entry->header.marked = 0;
+    entry->header.permanent = 1;
+    entry->header.hashed = 1;
+    entry->header.hash = (uint32_t)hash;
+    memcpy(entry->chars, chars, length);
+    entry->chars[length] = '\0';
+
+    size_t index = hash & (pool_capacity - 1);
+    entry->next = pool_buckets[index];
+    pool_buckets[index] = entry;
+    pool_count++;
+    return entry->chars;
+}
+
+const char* string_pool_retain(const char *str) {
+    pool_entry(str)->refcount++;
+    return str;
+}
+
+void string_pool_release(const char *str) {
+    PooledString *entry = pool_entry(str);
+    if (--entry->refcount > 0) return;
+
+    PooledString **link = &pool_buckets[entry->hash & (pool_capacity - 1)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    pool_count--;
+    free(entry);
+}
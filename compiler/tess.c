@@ -6,64 +6,102 @@
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
-#include "package.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "resolver.h"
+#include "module.h"
+#include "module_cache.h"
+#include "gc.h"
+#include "inline_cache.h"
 
 double g_compile_time = 0;
 double g_execute_time = 0;
 double g_total_time = 0;
 
+static Engine g_engine = ENGINE_VM;
+static int g_ic_stats = 0;
+
+int tess_set_engine(const char *name) {
+    if (strcmp(name, "vm") == 0) {
+        g_engine = ENGINE_VM;
+    } else if (strcmp(name, "ast") == 0) {
+        g_engine = ENGINE_AST;
+    } else {
+        return 1;
+    }
+    return 0;
+}
+
+void tess_set_cache(int enabled) {
+    module_cache_set_enabled(enabled);
+}
+
+void tess_set_trace_imports(int enabled) {
+    module_set_trace(enabled);
+}
+
+void tess_set_ic_stats(int enabled) {
+    g_ic_stats = enabled;
+}
+
+int tess_set_gc_growth(const char *factor) {
+    char *end;
+    double value = strtod(factor, &end);
+    if (end == factor || *end != '\0' || !(value > 1.0)) {
+        return 1;
+    }
+    gc_set_growth_factor(value);
+    return 0;
+}
+
+int tess_set_max_depth(const char *depth) {
+    char *end;
+    long value = strtol(depth, &end, 10);
+    if (end == depth || *end != '\0' || value < 1) {
+        return 1;
+    }
+    interpreter_set_max_depth((size_t)value);
+    return 0;
+}
+
 int tess_run(const char *filename) {
     clock_t start_total = clock();
     
-    FILE *file = fopen(filename, "r");
-    if (!file) {
+    clock_t start_compile = clock();
+    
+    Arena *arena = arena_create();
+    ASTNode *ast = module_parse_file(filename, arena);
+    if (!ast) {
         fprintf(stderr, "Error: Could not open file '%s'\n", filename);
+        arena_destroy(arena);
         return 1;
     }
     
-    fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    char *source = malloc(file_size + 1);
-    fread(source, 1, file_size, file);
-    source[file_size] = '\0';
-    fclose(file);
-    
-    clock_t start_compile = clock();
-    
-    Lexer *lexer = lexer_create(source);
-    lexer_tokenize(lexer);
+    Interpreter *interpreter = interpreter_create();
+    interpreter->engine = g_engine;
     
-    if (lexer->token_count == 0) {
-        free(source);
-        lexer_destroy(lexer);
-        return 0;
+    resolver_resolve(interpreter, ast);
+    Proto *proto = g_engine == ENGINE_VM ? bytecode_compile(ast) : NULL;
+    if (g_engine == ENGINE_VM && !proto) {
+        interpreter_destroy(interpreter);
+        arena_destroy(arena);
+        return 1;
     }
     
-    Parser *parser = parser_create(lexer);
-    ASTNode *ast = parser_parse(parser);
-    
     clock_t end_compile = clock();
     g_compile_time = (double)(end_compile - start_compile) / CLOCKS_PER_SEC;
     
     clock_t start_exec = clock();
     
-    Interpreter *interpreter = interpreter_create();
-    
-    Value args_list = {VALUE_LIST, {0}};
-    args_list.as.list = malloc(sizeof(List));
-    args_list.as.list->count = 0;
-    args_list.as.list->capacity = 4;
-    args_list.as.list->items = malloc(sizeof(Value) * 4);
-    
-    interpreter_set_variable(interpreter, "argv", args_list);
+    interpreter_set_variable(interpreter, "argv", value_list(gc_new_list(4)));
     
-    if (ast && ast->type == AST_PROGRAM) {
+    if (proto) {
+        vm_execute(interpreter, proto);
+    } else if (ast && ast->type == AST_PROGRAM) {
         ASTNode *stmt = ast->children;
         while (stmt) {
             interpreter_eval(interpreter, stmt);
-            if (interpreter->error_occurred) break;
+            if (interpreter->error_occurred || interpreter->completion != COMPLETION_NORMAL) break;
             stmt = stmt->next;
         }
     }
@@ -74,11 +112,10 @@ int tess_run(const char *filename) {
     clock_t end_total = clock();
     g_total_time = (double)(end_total - start_total) / CLOCKS_PER_SEC;
     
-    ast_destroy_tree(ast);
-    parser_destroy(parser);
-    lexer_destroy(lexer);
+    if (g_ic_stats) inline_cache_report(stderr);
+    bytecode_destroy(proto);
     interpreter_destroy(interpreter);
-    free(source);
+    arena_destroy(arena);
     
     return 0;
 }
@@ -125,6 +162,13 @@ int tess_repl(void) {
     
     char line[1024];
     Interpreter *interpreter = interpreter_create();
+    interpreter->engine = g_engine;
+    
+    /* Globals defined on one line point into that line's tree and code. */
+    Arena **lines = NULL;
+    Proto **protos = NULL;
+    size_t line_count = 0;
+    size_t line_capacity = 0;
     
     while (1) {
         printf(">> ");
@@ -135,51 +179,83 @@ int tess_repl(void) {
         
         if (strcmp(line, "exit") == 0) break;
         
-        Lexer *lexer = lexer_create(line);
+        Arena *arena = arena_create();
+        Lexer *lexer = lexer_create(line, strlen(line), arena);
         lexer_tokenize(lexer);
         Parser *parser = parser_create(lexer);
         ASTNode *ast = parser_parse(parser);
+        resolver_resolve(interpreter, ast);
+        Proto *proto = NULL;
         
-        if (ast && ast->type == AST_PROGRAM) {
+        if (g_engine == ENGINE_VM) {
+            proto = bytecode_compile(ast);
+            Value result = vm_execute(interpreter, proto);
+            if (value_type(result) == VALUE_NUMBER) printf("%g\n", value_as_number(result));
+            else if (value_type(result) == VALUE_STRING) printf("%s\n", value_as_string(result));
+            interpreter->error_occurred = 0;
+        } else if (ast && ast->type == AST_PROGRAM) {
             ASTNode *stmt = ast->children;
             while (stmt) {
                 Value result = interpreter_eval(interpreter, stmt);
-                if (result.type != VALUE_NULL) {
-                    if (result.type == VALUE_NUMBER) printf("%g\n", result.as.number);
-                    else if (result.type == VALUE_STRING) printf("%s\n", result.as.string);
+                if (value_type(result) != VALUE_NULL) {
+                    if (value_type(result) == VALUE_NUMBER) printf("%g\n", value_as_number(result));
+                    else if (value_type(result) == VALUE_STRING) printf("%s\n", value_as_string(result));
                 }
+                interpreter->completion = COMPLETION_NORMAL;
                 stmt = stmt->next;
             }
         }
         
-        ast_destroy_tree(ast);
+        if (line_count >= line_capacity) {
+            line_capacity = line_capacity == 0 ? 16 : line_capacity * 2;
+            lines = realloc(lines, sizeof(Arena*) * line_capacity);
+            protos = realloc(protos, sizeof(Proto*) * line_capacity);
+        }
+        lines[line_count] = arena;
+        protos[line_count] = proto;
+        line_count++;
+        
         parser_destroy(parser);
         lexer_destroy(lexer);
     }
     
     interpreter_destroy(interpreter);
+    for (size_t i = 0; i < line_count; i++) {
+        bytecode_destroy(protos[i]);
+        arena_destroy(lines[i]);
+    }
+    free(lines);
+    free(protos);
     return 0;
 }
 
 int tess_exec(const char *code) {
-    Lexer *lexer = lexer_create(code);
+    Arena *arena = arena_create();
+    Lexer *lexer = lexer_create(code, strlen(code), arena);
     lexer_tokenize(lexer);
     Parser *parser = parser_create(lexer);
     ASTNode *ast = parser_parse(parser);
     Interpreter *interpreter = interpreter_create();
+    interpreter->engine = g_engine;
+    resolver_resolve(interpreter, ast);
     
-    if (ast && ast->type == AST_PROGRAM) {
+    if (g_engine == ENGINE_VM) {
+        Proto *proto = bytecode_compile(ast);
+        vm_execute(interpreter, proto);
+        bytecode_destroy(proto);
+    } else if (ast && ast->type == AST_PROGRAM) {
         ASTNode *stmt = ast->children;
-        while (stmt) {
+        while (stmt && interpreter->completion == COMPLETION_NORMAL) {
             interpreter_eval(interpreter, stmt);
             stmt = stmt->next;
         }
     }
     
-    ast_destroy_tree(ast);
+    if (g_ic_stats) inline_cache_report(stderr);
     parser_destroy(parser);
     lexer_destroy(lexer);
     interpreter_destroy(interpreter);
+    arena_destroy(arena);
     return 0;
 }
 
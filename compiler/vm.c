@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "vm.h"
+#include "tess_alloc.h"
+#include "gc.h"
+#include "tess_string.h"
+#include "inline_cache.h"
+
+static Value vm_run(Interpreter *interpreter, Proto *proto, Value *args, int argc);
+
+static Proto* vm_proto(ASTNode *func_node) {
+    return func_node->proto ? func_node->proto : bytecode_compile_function(func_node);
+}
+
+/* args points into the value stack and is where the callee's registers
+ * start, so everything above it must be free for the callee to use. */
+Value vm_call_function(Interpreter *interpreter, ASTNode *func_node, Value *args, int argc) {
+    if (!func_node->children) {
+        return value_null();
+    }
+
+    Value result = vm_run(interpreter, vm_proto(func_node), args, argc);
+    fflush(stdout);
+    return result;
+}
+
+/* Returns the function a call to func_value should enter, or NULL after
+ * reporting that there is none. */
+static ASTNode* vm_callee(Value func_value, const char *name) {
+    if (value_type(func_value) == VALUE_FUNCTION && value_as_function(func_value)) {
+        return value_as_function(func_value);
+    }
+
+    if (!name) {
+        printf("Error: main function not found\n");
+    } else {
+        printf("Warning: function '%s' not found\n", name);
+    }
+    fflush(stdout);
+    return NULL;
+}
+
+/* Finishes a member access or call that needs no new frame and returns
+ * NULL, or returns the script method the caller should enter. */
+static ASTNode* vm_invoke(Value *base, InlineCache *cache, int argc, int is_call, Value *out) {
+    Value obj = base[0];
+    *out = value_null();
+
+    if (value_type(obj) == VALUE_FILE) {
+        BuiltinFunc func = cache->file_method;
+        if (func) {
+            *out = func(base, is_call ? argc + 1 : 1);
+            return NULL;
+        }
+    }
+
+    Value member;
+    if (!inline_cache_find(cache, obj, &member)) {
+        return NULL;
+    }
+    if (!is_call || value_type(member) != VALUE_FUNCTION) {
+        *out = member;
+        return NULL;
+    }
+
+    if (!value_as_function(member)) {
+        BuiltinFunc builtin = cache->builtin;
+        if (builtin) {
+            *out = builtin(base, argc + 1);
+        }
+        return NULL;
+    }
+    return value_as_function(member);
+}
+
+/* Pushes a frame for proto whose registers start at args, so parameters
+ * are the arguments the caller left there. A callee's registers may cover
+ * the caller's beyond its arguments, so try handlers go on their own
+ * stack. A NULL proto is a function that failed to compile. */
+static int vm_push_frame(Interpreter *interpreter, Proto *proto, Value *args, int argc, int result) {
+    if (!proto) {
+        interpreter->error_occurred = 1;
+        return 0;
+    }
+    size_t end = (size_t)(args - interpreter->stack) + proto->register_count;
+    if (interpreter->frame_count >= interpreter->max_depth || end > INTERPRETER_STACK_SIZE) {
+        return interpreter_stack_overflow(interpreter);
+    }
+    if (interpreter->frame_count >= interpreter->frame_capacity) {
+        interpreter->frame_capacity = interpreter->frame_capacity == 0 ? 64 : interpreter->frame_capacity * 2;
+        interpreter->frames = tess_realloc(interpreter->frames, sizeof(CallFrame) * interpreter->frame_capacity);
+    }
+
+    CallFrame *frame = &interpreter->frames[interpreter->frame_count++];
+    frame->proto = proto;
+    frame->regs = args;
+    frame->pc = 0;
+    frame->handler_base = interpreter->handler_top;
+    frame->handler_count = 0;
+    frame->result = result;
+    frame->top = interpreter->stack_top;
+    if (end > interpreter->stack_top) interpreter->stack_top = end;
+
+    interpreter->handler_top += proto->handler_count;
+    if (interpreter->handler_top > interpreter->handler_capacity) {
+        interpreter->handler_capacity = interpreter->handler_top * 2;
+        interpreter->handlers = tess_realloc(interpreter->handlers, sizeof(size_t) * interpreter->handler_capacity);
+    }
+
+    if (argc > proto->param_count) argc = proto->param_count;
+    for (int i = argc; i < proto->register_count; i++) {
+        args[i] = value_null();
+    }
+    return 1;
+}
+
+static Value vm_new_list(Value *items, int count) {
+    List *list = gc_new_list(count);
+    list->count = count;
+    if (count > 0) {
+        memcpy(list->items, items, sizeof(Value) * count);
+    }
+    return value_list(list);
+}
+
+static Value vm_new_dict(void) {
+    return value_dict(gc_new_dict(16));
+}
+
+#define ARITH(binop, expr) do { \
+        Value l = regs[ins->b]; \
+        Value r = regs[ins->c]; \
+        if (value_type(l) == VALUE_NUMBER && value_type(r) == VALUE_NUMBER) { \
+            double x = value_as_number(l), y = value_as_number(r); \
+            regs[ins->a] = value_number(expr); \
+        } else { \
+            regs[ins->a] = interpreter_binary_op(binop, l, r); \
+        } \
+    } while (0)
+
+#define VM_LOAD_FRAME() do { \
+        CallFrame *current = &interpreter->frames[interpreter->frame_count - 1]; \
+        proto = current->proto; \
+        regs = current->regs; \
+        pc = current->pc; \
+        handler_count = current->handler_count; \
+        handler_base = current->handler_base; \
+        k = proto->constants; \
+        code = proto->code; \
+    } while (0)
+
+#define VM_CALL(func_node, args, argc, dst) do { \
+        interpreter->frames[interpreter->frame_count - 1].pc = pc; \
+        interpreter->frames[interpreter->frame_count - 1].handler_count = handler_count; \
+        if (!vm_push_frame(interpreter, vm_proto(func_node), args, argc, dst)) { \
+            regs[dst] = value_null(); \
+            goto error; \
+        } \
+        VM_LOAD_FRAME(); \
+        if (gc_pending) gc_collect(interpreter); \
+    } while (0)
+
+/* Runs entry and every script function it calls in one loop. A call pushes
+ * a CallFrame and a return pops one, so call depth is bounded by
+ * interpreter->max_depth and the value stack rather than the C stack. */
+static Value vm_run(Interpreter *interpreter, Proto *entry, Value *args, int argc) {
+    size_t base = interpreter->frame_count;
+    if (!vm_push_frame(interpreter, entry, args, argc, 0)) {
+        return value_null();
+    }
+
+    Proto *proto;
+    Value *regs;
+    Value *k;
+    Instruction *code;
+    size_t pc;
+    size_t handler_base;
+    int handler_count;
+    Value result = value_null();
+    VM_LOAD_FRAME();
+
+    if (gc_pending) gc_collect(interpreter);
+
+    for (;;) {
+        Instruction *ins = &code[pc++];
+        switch ((OpCode)ins->op) {
+            case OP_LOADK:
+                regs[ins->a] = k[ins->b];
+                break;
+
+            case OP_LOADNULL:
+                regs[ins->a] = value_null();
+                break;
+
+            case OP_MOVE:
+                string_finish(regs[ins->b]);
+                regs[ins->a] = regs[ins->b];
+                break;
+
+            case OP_GETGLOBAL:
+                regs[ins->a] = interpreter->globals[ins->b].value;
+                break;
+
+            case OP_SETGLOBAL:
+                interpreter->globals[ins->b].value = regs[ins->a];
+                break;
+
+            case OP_ADD: ARITH(BINOP_ADD, x + y); break;
+            case OP_SUB: ARITH(BINOP_SUB, x - y); break;
+            case OP_MUL: ARITH(BINOP_MUL, x * y); break;
+            case OP_DIV: ARITH(BINOP_DIV, x / y); break;
+            case OP_MOD: ARITH(BINOP_MOD, fmod(x, y)); break;
+            case OP_GT: ARITH(BINOP_GT, x > y); break;
+            case OP_LT: ARITH(BINOP_LT, x < y); break;
+            case OP_EQ: ARITH(BINOP_EQ, x == y); break;
+            case OP_NEQ: ARITH(BINOP_NEQ, x != y); break;
+            case OP_LTE: ARITH(BINOP_LTE, x <= y); break;
+            case OP_GTE: ARITH(BINOP_GTE, x >= y); break;
+
+            case OP_APPEND: {
+                Value *target = &regs[ins->a];
+                Value part = regs[ins->b];
+                if (ins->c == 1 && value_type(*target) == VALUE_NUMBER && value_type(part) == VALUE_NUMBER) {
+                    *target = value_number(value_as_number(*target) + value_as_number(part));
+                } else {
+                    *target = interpreter_append(*target, &regs[ins->b], ins->c);
+                }
+                break;
+            }
+
+            case OP_JMP:
+                pc = ins->target;
+                if (gc_pending) gc_collect(interpreter);
+                break;
+
+            case OP_JMPIFNOT:
+                if (!interpreter_is_truthy(regs[ins->a])) pc = ins->target;
+                break;
+
+            case OP_REPEAT: {
+                Value *counter = &regs[ins->a];
+                if (value_type(*counter) != VALUE_NUMBER || value_as_number(*counter) < 1) {
+                    pc = ins->target;
+                } else {
+                    *counter = value_number(value_as_number(*counter) - 1);
+                }
+                break;
+            }
+
+            case OP_CALL: {
+                ASTNode *callee = vm_callee(regs[ins->a], value_as_string(k[ins->c]));
+                if (!callee || !callee->children) {
+                    regs[ins->a] = value_null();
+                    break;
+                }
+                VM_CALL(callee, &regs[ins->a + 1], ins->b, ins->a);
+                break;
+            }
+
+            case OP_BUILTIN:
+                regs[ins->a] = proto->builtins[ins->c](&regs[ins->a + 1], ins->b);
+                if (interpreter->error_occurred) goto error;
+                break;
+
+            case OP_START: {
+                ASTNode *callee = vm_callee(interpreter->globals[ins->b].value, NULL);
+                if (!callee || !callee->children) {
+                    regs[ins->a] = value_null();
+                    break;
+                }
+                VM_CALL(callee, interpreter->stack + interpreter->stack_top, 0, ins->a);
+                break;
+            }
+
+            case OP_INVOKE: {
+                Value member;
+                ASTNode *method = vm_invoke(&regs[ins->a], proto->caches[ins->c], ins->b, 1, &member);
+                if (method && method->children) {
+                    VM_CALL(method, &regs[ins->a + 1], ins->b, ins->a);
+                    break;
+                }
+                regs[ins->a] = member;
+                if (interpreter->error_occurred) goto error;
+                break;
+            }
+
+            case OP_GETMEMBER: {
+                Value member;
+                vm_invoke(&regs[ins->b], proto->caches[ins->c], 0, 0, &member);
+                regs[ins->a] = member;
+                if (interpreter->error_occurred) goto error;
+                break;
+            }
+
+            case OP_INDEX:
+                regs[ins->a] = interpreter_index(interpreter, regs[ins->b], regs[ins->c]);
+                if (interpreter->error_occurred) goto error;
+                break;
+
+            case OP_NEWLIST:
+                regs[ins->a] = vm_new_list(&regs[ins->b], ins->c);
+                break;
+
+            case OP_NEWDICT:
+                regs[ins->a] = vm_new_dict();
+                break;
+
+            case OP_NEW:
+                regs[ins->a] = interpreter_new_object(regs[ins->b]);
+                break;
+
+            case OP_PRINT:
+                for (int i = 0; i < ins->b; i++) {
+                    interpreter_print_value(regs[ins->a + i]);
+                    if (i + 1 < ins->b) printf(" ");
+                }
+                printf("\n");
+                fflush(stdout);
+                break;
+
+            case OP_HTTP:
+                regs[ins->a] = interpreter_http_request(regs[ins->b], regs[ins->b + 1],
+                                                        ins->c ? &regs[ins->b + 2] : NULL);
+                break;
+
+            case OP_IMPORT:
+                interpreter_import(interpreter, value_as_string(k[ins->b]));
+                if (interpreter->error_occurred) goto error;
+                break;
+
+            case OP_TRY:
+                interpreter->error_occurred = 0;
+                interpreter->handlers[handler_base + handler_count++] = ins->target;
+                break;
+
+            case OP_ENDTRY:
+                handler_count--;
+                break;
+
+            case OP_CATCH:
+                regs[ins->a] = interpreter_take_error(interpreter);
+                break;
+
+            case OP_RETURN:
+                result = regs[ins->a];
+                goto leave;
+        }
+        continue;
+
+    error:
+        if (handler_count > 0) {
+            pc = interpreter->handlers[handler_base + --handler_count];
+            continue;
+        }
+        result = value_null();
+
+    leave: {
+            CallFrame *frame = &interpreter->frames[--interpreter->frame_count];
+            interpreter->stack_top = frame->top;
+            interpreter->handler_top = frame->handler_base;
+            if (interpreter->frame_count == base) {
+                return result;
+            }
+            int dst = frame->result;
+            VM_LOAD_FRAME();
+            regs[dst] = result;
+            if (interpreter->error_occurred) goto error;
+        }
+    }
+}
+
+Value vm_execute(Interpreter *interpreter, Proto *proto) {
+    return vm_run(interpreter, proto, interpreter->stack + interpreter->stack_top, 0);
+}